@@ -109,4 +109,108 @@ TEST_SUITE("CAN Functions") {
         CHECK(static_cast<InputMode>(can_getSignal<InputMode>(buf, 0, 8, true, 1, 0)) == INPUT_MODE_MIX_CHANNELS);
         CHECK(static_cast<InputMode>(can_getSignal<InputMode>(buf, 8, 8, true, 1, 0)) == INPUT_MODE_PASSTHROUGH);
     }
-}
\ No newline at end of file
+
+    TEST_CASE("setSignal descriptor") {
+        uint8_t buf[8];
+        std::memset(buf, 0xFF, sizeof(buf));
+        const can_Signal temp = {20, 9, false, true, 0.5f, -10.0f};
+        can_setSignal(buf, -42.0f, temp);
+        CHECK(can_getRawSignal(buf, temp) == -64);
+        CHECK(can_getSignal(buf, temp) == -42.0f);
+        uint64_t word;
+        std::memcpy(&word, buf, 8);
+        CHECK((word | can_signalMask(temp)) == -1ULL); // neighbouring bits untouched
+    }
+
+    TEST_CASE("signals beyond the first 8 bytes") {
+        uint8_t fd[64];
+        for (size_t i = 0; i < sizeof(fd); ++i)
+            fd[i] = static_cast<uint8_t>(i * 37 + 11);
+        for (uint16_t start = 0; start < 64 * 8; start += 5) {
+            for (int intel = 0; intel < 2; ++intel) {
+                const can_Signal sig = {start, 13, intel != 0, true, 1.0f, 0.0f};
+                const size_t first = can_signalWindow(sig);
+                if (first + 8 > sizeof(fd) || (!sig.isIntel && start % 8 + 13 > start + 8 - start % 8))
+                    continue; // past the end, or Motorola bits running off byte 0
+                uint8_t window[8];
+                std::memcpy(window, fd + first, 8);
+                can_Signal local = sig;
+                local.startBit = static_cast<uint16_t>(start - 8 * first);
+                CHECK(can_getRawSignal(fd, sizeof(fd), sig) == can_getRawSignal(window, local));
+
+                uint8_t copy[64];
+                std::memcpy(copy, fd, sizeof(fd));
+                can_setRawSignal(copy, sizeof(copy), -1234, sig);
+                CHECK(can_getRawSignal(copy, sizeof(copy), sig) == -1234);
+            }
+        }
+
+        const can_Signal motorola = {8 * 20 + 3, 12, false, false, 1.0f, 0.0f}; // LSB in byte 20, MSB in byte 19
+        uint8_t buf[24] = {0};
+        can_setRawSignal(buf, sizeof(buf), 0xABC, motorola);
+        CHECK(buf[19] == 0x55);
+        CHECK(buf[20] == 0xE0);
+        CHECK(can_getRawSignal(buf, 20, motorola) == (0x55 << 5)); // byte 20 missing reads as zero
+    }
+}
+TEST_SUITE("Raw predicates") {
+    static void checkAllRaw(const can_Signal& sig, const float* thresholds, const size_t count) {
+        const can_CompareOp ops[] = {CAN_LT, CAN_LE, CAN_GT, CAN_GE, CAN_EQ, CAN_NE};
+        int64_t lo, hi;
+        can_rawDomain(sig, lo, hi);
+        for (size_t t = 0; t < count; ++t) {
+            for (size_t o = 0; o < 6; ++o) {
+                const can_RawPredicate pred = can_compilePredicate(sig, ops[o], thresholds[t]);
+                for (int64_t raw = lo; raw <= hi; ++raw) {
+                    uint8_t buf[8] = {0};
+                    can_setSignal<uint64_t>(buf, static_cast<uint64_t>(raw), sig.startBit, sig.length, sig.isIntel);
+                    const bool expected = can_comparePhysical(can_getSignal(buf, sig), ops[o], thresholds[t]);
+                    if (can_matches(buf, pred) != expected) {
+                        FAIL("raw " << raw << " op " << o << " threshold " << thresholds[t]);
+                    }
+                }
+            }
+        }
+    }
+
+    TEST_CASE("matches scaled getSignal, positive factor") {
+        const can_Signal sig = {3, 10, true, false, 0.25f, -20.0f};
+        const float thresholds[] = {-100.0f, -20.0f, -19.9f, 0.0f, 6.125f, 7.25f, 235.75f, 236.0f, 500.0f};
+        checkAllRaw(sig, thresholds, sizeof(thresholds) / sizeof(thresholds[0]));
+    }
+
+    TEST_CASE("matches scaled getSignal, negative factor and signed") {
+        const can_Signal sig = {20, 9, false, true, -0.1f, 5.0f};
+        const float thresholds[] = {-30.0f, -20.6f, -0.05f, 0.0f, 5.0f, 5.1f, 30.6f, 31.0f};
+        checkAllRaw(sig, thresholds, sizeof(thresholds) / sizeof(thresholds[0]));
+    }
+
+    TEST_CASE("constant signal") {
+        const can_Signal sig = {0, 4, true, false, 0.0f, 3.0f};
+        const float thresholds[] = {2.0f, 3.0f, 4.0f};
+        checkAllRaw(sig, thresholds, sizeof(thresholds) / sizeof(thresholds[0]));
+    }
+
+    TEST_CASE("batch filter") {
+        // EngineSpeed > 6000 rpm at 0.125 rpm/bit
+        const can_Signal speed = {24, 16, true, false, 0.125f, 0.0f};
+        const can_RawPredicate pred = can_compilePredicate(speed, CAN_GT, 6000.0f);
+
+        can_Frame frames[64];
+        uint64_t words[64];
+        std::memset(frames, 0, sizeof(frames));
+        size_t expected = 0;
+        for (int i = 0; i < 64; ++i) {
+            can_setSignal<uint16_t>(can_frameData(frames[i]), static_cast<uint16_t>(i * 1000), 24, 16, true);
+            std::memcpy(&words[i], frames[i].data, 8);
+            expected += (i * 1000 * 0.125f) > 6000.0f;
+        }
+
+        uint8_t byFrame[64], byWord[64];
+        CHECK(can_filterBatch(frames, 64, pred, byFrame) == expected);
+        CHECK(can_matchWords(words, 64, pred, byWord) == expected);
+        CHECK(std::memcmp(byFrame, byWord, 64) == 0);
+        CHECK(byFrame[48] == 0);
+        CHECK(byFrame[49] == 1);
+    }
+}
@@ -0,0 +1,90 @@
+#include "../can_canopen.hpp"
+
+#include "doctest.h"
+
+TEST_SUITE("CANopen PDO") {
+    struct Axis {
+        uint16_t controlword = 0;
+        int8_t mode = 0;
+        int32_t targetPosition = 0;
+        uint8_t flags = 0;
+        int16_t torque = 0;
+    };
+
+    template <size_t N>
+    void addAxis(can_ObjectDictionary<N>& od, Axis& axis) {
+        od.add(0x6040, 0, axis.controlword);
+        od.add(0x6060, 0, axis.mode);
+        od.add(0x607A, 0, axis.targetPosition);
+        od.add(0x2000, 1, axis.flags);
+        od.add(0x6071, 0, axis.torque);
+    }
+
+    TEST_CASE("pack matches setSignal") {
+        Axis axis;
+        can_ObjectDictionary<8> od;
+        addAxis(od, axis);
+        CHECK_FALSE(od.add(0x6040, 0, axis.controlword));
+
+        // controlword, 4 flag bits, a 4-bit dummy, target position, mode
+        const uint32_t mapping[] = {can_pdoMapping(0x6040, 0, 16), can_pdoMapping(0x2000, 1, 4), can_pdoMapping(0x0005, 0, 4),
+                                    can_pdoMapping(0x607A, 0, 32), can_pdoMapping(0x6060, 0, 8)};
+        can_PdoMap tpdo;
+        REQUIRE(tpdo.compile(mapping, 5, od));
+        CHECK(tpdo.size() == 4);
+        CHECK(tpdo.length() == 8);
+
+        axis.controlword = 0x000F;
+        axis.flags = 0xFA; // only the low 4 bits are mapped
+        axis.targetPosition = -123456;
+        axis.mode = -1;
+        uint8_t buf[8];
+        std::memset(buf, 0xAA, sizeof(buf));
+        CHECK(tpdo.pack(buf) == 8);
+
+        uint8_t expected[8] = {0};
+        can_setSignal<uint16_t>(expected, axis.controlword, 0, 16, true);
+        can_setSignal<uint8_t>(expected, 0xA, 16, 4, true);
+        can_setSignal<uint32_t>(expected, static_cast<uint32_t>(axis.targetPosition), 24, 32, true);
+        can_setSignal<uint8_t>(expected, 0xFF, 56, 8, true);
+        CHECK(std::memcmp(buf, expected, 8) == 0);
+    }
+
+    TEST_CASE("unpack into another dictionary") {
+        Axis sender, receiver;
+        can_ObjectDictionary<8> tx, rx;
+        addAxis(tx, sender);
+        addAxis(rx, receiver);
+        const uint32_t mapping[] = {can_pdoMapping(0x6040, 0, 16), can_pdoMapping(0x6071, 0, 16), can_pdoMapping(0x6060, 0, 8)};
+        can_PdoMap tpdo, rpdo;
+        REQUIRE(tpdo.compile(mapping, 3, tx));
+        REQUIRE(rpdo.compile(mapping, 3, rx));
+        CHECK(tpdo.length() == 5);
+
+        sender.controlword = 0x1234;
+        sender.torque = -300;
+        sender.mode = 8;
+        uint8_t buf[8];
+        const uint8_t len = tpdo.pack(buf);
+        CHECK_FALSE(rpdo.unpack(buf, 4));
+        CHECK(receiver.controlword == 0);
+        REQUIRE(rpdo.unpack(buf, len));
+        CHECK(receiver.controlword == 0x1234);
+        CHECK(receiver.torque == -300);
+        CHECK(receiver.mode == 8);
+    }
+
+    TEST_CASE("invalid mappings") {
+        Axis axis;
+        can_ObjectDictionary<8> od;
+        addAxis(od, axis);
+        can_PdoMap pdo;
+        const uint32_t missing[] = {can_pdoMapping(0x6041, 0, 16)};
+        CHECK_FALSE(pdo.compile(missing, 1, od));
+        const uint32_t tooWide[] = {can_pdoMapping(0x6060, 0, 16)};
+        CHECK_FALSE(pdo.compile(tooWide, 1, od));
+        const uint32_t tooLong[] = {can_pdoMapping(0x607A, 0, 32), can_pdoMapping(0x607A, 0, 32), can_pdoMapping(0x6060, 0, 8)};
+        CHECK_FALSE(pdo.compile(tooLong, 3, od));
+        CHECK(pdo.size() == 0);
+    }
+}
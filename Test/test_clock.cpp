@@ -0,0 +1,91 @@
+#include "../can_clock.hpp"
+
+#include "doctest.h"
+
+#include <cmath>
+#include <cstdlib>
+
+TEST_SUITE("Clock domains") {
+    TEST_CASE("unwrapping hardware counters") {
+        can_TimestampUnwrapper u16(16);
+        const uint64_t raw[] = {65500, 65535, 4, 60000, 120, 121};
+        const uint64_t expected[] = {65500, 65535, 65540, 125536, 131192, 131193};
+        for (size_t i = 0; i < 6; ++i)
+            CHECK(u16.unwrap(raw[i]) == expected[i]);
+
+        can_TimestampUnwrapper u32(32);
+        uint64_t batch[] = {0xFFFFFF00u, 0x00000010u, 0x80000000u, 0x00000001u};
+        u32.unwrap(batch, 4);
+        CHECK(batch[1] == 0x100000010ULL);
+        CHECK(batch[2] == 0x180000000ULL);
+        CHECK(batch[3] == 0x200000001ULL);
+
+        can_TimestampUnwrapper full;
+        CHECK(full.unwrap(123456789012ULL) == 123456789012ULL);
+        CHECK(full.unwrap(123456789999ULL) == 123456789999ULL);
+    }
+
+    TEST_CASE("drift and offset from shared events") {
+        can_ClockFit fit;
+        CHECK(fit.map().slope == 1.0);
+        // Local clock runs 80 ppm fast and started 3.2 s after the reference one
+        const double rate = 1.0 + 80e-6;
+        std::srand(9);
+        for (int i = 0; i < 500; ++i) {
+            const uint64_t reference = 5000000000ULL + static_cast<uint64_t>(i) * 20000 + std::rand() % 1000;
+            const uint64_t local = static_cast<uint64_t>((static_cast<double>(reference) - 3200000.0) * rate);
+            fit.add(local, reference);
+        }
+        CHECK(fit.size() == 500);
+        CHECK(fit.drift() == doctest::Approx(1.0 / rate - 1.0).epsilon(1e-9));
+
+        const can_ClockMap map = fit.map();
+        uint64_t locals[64], references[64];
+        for (int i = 0; i < 64; ++i) {
+            references[i] = 5000000000ULL + static_cast<uint64_t>(i) * 157339;
+            locals[i] = static_cast<uint64_t>(std::llround((static_cast<double>(references[i]) - 3200000.0) * rate));
+        }
+        can_mapTimestamps(locals, 64, map);
+        for (int i = 0; i < 64; ++i)
+            CHECK(std::llabs(static_cast<long long>(locals[i] - references[i])) <= 1);
+    }
+
+    TEST_CASE("forgetting tracks a change of drift") {
+        can_ClockFit steady, tracking(0.9);
+        for (int i = 0; i < 400; ++i) {
+            const uint64_t local = static_cast<uint64_t>(i) * 10000;
+            const uint64_t reference = i < 200 ? local : 2000000 + static_cast<uint64_t>((local - 2000000) * 1.001);
+            steady.add(local, reference);
+            tracking.add(local, reference);
+        }
+        CHECK(tracking.slope() == doctest::Approx(1.001).epsilon(1e-6));
+        CHECK(steady.slope() < 1.0009);
+        tracking.reset();
+        CHECK(tracking.size() == 0);
+    }
+
+    TEST_CASE("multi-bus normalisation") {
+        // Bus 0 is the reference with host microseconds; bus 1 has a 16-bit
+        // microsecond counter running 50 ppm slow and offset by 12345
+        can_ClockDomains<2> domains;
+        domains.setCounterBits(1, 16);
+        can_Frame frames[300] = {};
+        uint64_t truth[300];
+        for (int i = 0; i < 300; ++i) {
+            const uint64_t t = 1000000 + static_cast<uint64_t>(i) * 997;
+            truth[i] = t;
+            frames[i].bus = static_cast<uint8_t>(i % 2);
+            const uint64_t local = static_cast<uint64_t>(std::llround((t - 1000000) * (1.0 - 50e-6))) + 12345;
+            frames[i].timestamp = frames[i].bus ? local & 0xFFFF : t;
+            if (i % 10 == 1)
+                domains.observe(1, local, t); // the same event seen on both buses, unwrapped
+        }
+        domains.normalize(frames, 300);
+        for (int i = 0; i < 300; ++i) {
+            CAPTURE(i);
+            CHECK(std::llabs(static_cast<long long>(frames[i].timestamp - truth[i])) <= 1);
+        }
+        CHECK(domains.fit(1).drift() == doctest::Approx(1.0 / (1.0 - 50e-6) - 1.0).epsilon(1e-6));
+        CHECK(domains.map(0).slope == 1.0);
+    }
+}
@@ -0,0 +1,124 @@
+#include "../can_columnar.hpp"
+
+#include "doctest.h"
+
+TEST_SUITE("Columnar log") {
+    TEST_CASE("bit extract / deposit") {
+        const uint64_t mask = 0xF00000000000F0F0ULL;
+        const uint64_t value = 0xA00000000000B0C0ULL;
+        const uint64_t packed = can_extractBits(value, mask);
+        CHECK(packed == 0xABCULL);
+        CHECK(can_depositBits(packed, mask) == value);
+        CHECK(can_extractBits(value, -1ULL) == value);
+        CHECK(can_unzigzag(can_zigzag(-12345)) == -12345);
+    }
+
+    TEST_CASE("round trip and compression") {
+        const char* path = "Test/test_tmp.ccol";
+        std::vector<can_Frame> frames;
+        uint64_t t = 1000000;
+        for (uint32_t i = 0; i < 3000; ++i) {
+            can_Frame frame;
+            std::memset(&frame, 0, sizeof(frame));
+            frame.id = (i % 3 == 2) ? 0x18FEF100 : 0x100 + (i % 3);
+            frame.flags = (i % 3 == 2) ? (CAN_FRAME_EXTENDED | CAN_FRAME_FD) : 0;
+            frame.len = (i % 3 == 2) ? 12 : 8;
+            frame.timestamp = t + (i % 7);
+            can_setSignal<uint8_t>(can_frameData(frame), i & 0x0F, 0, 4, true);
+            can_setSignal<uint16_t>(can_frameData(frame), 1000 + (i / 30), 16, 16, true);
+            if (frame.len > 8)
+                frame.data[8] = static_cast<uint8_t>(i / 100);
+            frames.push_back(frame);
+            t += 333;
+        }
+
+        {
+            can_ColumnarWriter writer(path, 512);
+            REQUIRE(writer.isOpen());
+            CHECK(writer.write(frames.data(), frames.size()));
+            CHECK(writer.close());
+        }
+
+        can_ColumnarReader reader;
+        REQUIRE(reader.open(path));
+
+        std::FILE* f = std::fopen(path, "rb");
+        std::fseek(f, 0, SEEK_END);
+        const long fileSize = std::ftell(f);
+        std::fclose(f);
+        CHECK(static_cast<size_t>(fileSize) * 4 < frames.size() * 16);
+
+        size_t total = 0;
+        can_ChunkHeader header;
+        std::vector<can_Frame> decoded;
+        while (reader.nextChunk(header)) {
+            decoded.resize(header.count);
+            REQUIRE(reader.decodeChunk(decoded.data()));
+            CHECK(header.minTimestamp == decoded.front().timestamp);
+            CHECK(header.maxTimestamp == decoded.back().timestamp);
+
+            // Frames of one ID appear in their original order
+            size_t j = 0;
+            for (size_t i = 0; i < frames.size() && j < decoded.size(); ++i) {
+                if (frames[i].id != header.id || frames[i].timestamp < decoded.front().timestamp)
+                    continue;
+                CHECK(decoded[j].timestamp == frames[i].timestamp);
+                CHECK(decoded[j].flags == frames[i].flags);
+                CHECK(decoded[j].len == frames[i].len);
+                CHECK(std::memcmp(decoded[j].data, frames[i].data, 64) == 0);
+                ++j;
+            }
+            CHECK(j == decoded.size());
+
+            std::vector<uint16_t> values(header.count);
+            can_getSignalBatch<uint16_t>(decoded.data(), header.count, values.data(), 16, 16, true);
+            CHECK(values.front() <= values.back());
+            total += header.count;
+        }
+        CHECK(total == frames.size());
+
+        reader.close();
+        std::remove(path);
+    }
+
+    TEST_CASE("corrupt chunks are rejected") {
+        const char* path = "Test/test_tmp_corrupt.ccol";
+        can_Frame frames[10];
+        std::memset(frames, 0, sizeof(frames));
+        for (int i = 0; i < 10; ++i) {
+            frames[i].id = 0x123;
+            frames[i].len = 8;
+            frames[i].timestamp = 1000 * i;
+            frames[i].data[0] = static_cast<uint8_t>(i);
+        }
+        {
+            can_ColumnarWriter writer(path);
+            REQUIRE(writer.write(frames, 10));
+            REQUIRE(writer.close());
+        }
+        std::FILE* f = std::fopen(path, "rb");
+        std::vector<uint8_t> good(4096);
+        good.resize(std::fread(good.data(), 1, good.size(), f));
+        std::fclose(f);
+
+        // Rewrite the file from the good image with a tweak, then try to read the chunk
+        auto readable = [&](void (*tweak)(std::vector<uint8_t>&)) {
+            std::vector<uint8_t> bytes = good;
+            tweak(bytes);
+            std::FILE* out = std::fopen(path, "wb");
+            std::fwrite(bytes.data(), 1, bytes.size(), out);
+            std::fclose(out);
+            can_ColumnarReader reader;
+            REQUIRE(reader.open(path));
+            can_ChunkHeader header;
+            return reader.nextChunk(header);
+        };
+        // The first chunk header follows the 8-byte magic and version
+        CHECK(readable([](std::vector<uint8_t>&) {}));
+        CHECK_FALSE(readable([](std::vector<uint8_t>& b) { b[8 + offsetof(can_ChunkHeader, len)] = 200; }));
+        CHECK_FALSE(readable([](std::vector<uint8_t>& b) { b[8 + offsetof(can_ChunkHeader, payloadBytes)] += 1; }));
+        CHECK_FALSE(readable([](std::vector<uint8_t>& b) { b[8 + offsetof(can_ChunkHeader, timestampBytes)] -= 1; }));
+        CHECK_FALSE(readable([](std::vector<uint8_t>& b) { b.resize(b.size() - 1); }));
+        std::remove(path);
+    }
+}
@@ -0,0 +1,128 @@
+#include "../can_deadline.hpp"
+
+#include "doctest.h"
+
+#include <vector>
+
+namespace {
+struct Event {
+    size_t message;
+    bool timedOut;
+    uint64_t now;
+};
+
+void record(void* context, const size_t message, const bool timedOut, const uint64_t now) {
+    Event e = {message, timedOut, now};
+    static_cast<std::vector<Event>*>(context)->push_back(e);
+}
+} // namespace
+
+TEST_SUITE("Deadline monitor") {
+    TEST_CASE("deadlines across many messages") {
+        const size_t COUNT = 2000;
+        std::vector<Event> events;
+        can_DeadlineMonitor<COUNT> monitor(nullptr, &record, &events);
+        // Cycle times of 10 to 100 ms in 1 ms ticks, deadline at three cycles;
+        // every 100th message falls silent at t = 500
+        for (size_t m = 0; m < COUNT; ++m)
+            REQUIRE(monitor.watch(m, 3 * (10 + m % 91), 0));
+
+        for (uint64_t t = 1; t <= 2000; ++t) {
+            for (size_t m = 0; m < COUNT; ++m) {
+                const bool silent = m % 100 == 0 && t > 500 && t <= 1500;
+                if (t % (10 + m % 91) == 0 && !silent)
+                    monitor.receive(m, t);
+            }
+            monitor.advance(t);
+            if (t == 1400)
+                CHECK(monitor.expiredCount() == 20);
+        }
+
+        size_t timeouts = 0, recoveries = 0;
+        for (const Event& e : events) {
+            CAPTURE(e.message);
+            CHECK(e.message % 100 == 0);
+            if (e.timedOut) {
+                ++timeouts;
+                const uint64_t cycle = 10 + e.message % 91;
+                CHECK(e.now == (500 / cycle) * cycle + 3 * cycle);
+            } else {
+                ++recoveries;
+                CHECK(e.now > 1500);
+            }
+        }
+        CHECK(timeouts == 20);
+        CHECK(recoveries == 20);
+        CHECK(monitor.expiredCount() == 0);
+    }
+
+    TEST_CASE("frames exactly at the deadline are in time") {
+        can_DeadlineMonitor<1> monitor;
+        monitor.watch(0, 100, 0);
+        monitor.receive(0, 100);
+        CHECK(monitor.advance(199) == 0);
+        CHECK_FALSE(monitor.expired(0));
+        CHECK(monitor.advance(200) == 1);
+        CHECK(monitor.expired(0));
+        CHECK(monitor.advance(1000) == 0); // fires once per outage
+
+        monitor.unwatch(0);
+        monitor.receive(0, 1001); // ignored
+        CHECK(monitor.advance(5000) == 0);
+        CHECK_FALSE(monitor.watch(1, 10, 0));
+        CHECK_FALSE(monitor.watch(0, 0, 0));
+    }
+
+    TEST_CASE("only advance fires expiries") {
+        std::vector<Event> events;
+        can_DeadlineMonitor<2> monitor(nullptr, &record, &events);
+        monitor.watch(0, 10, 0);
+        monitor.watch(1, 100, 0);
+        monitor.receive(1, 50); // long past message 0's deadline
+        CHECK(events.empty());
+        CHECK(monitor.advance(50) == 1);
+        REQUIRE(events.size() == 1);
+        CHECK(events[0].message == 0);
+        CHECK(events[0].now == 10);
+
+        const uint8_t buf[8] = {0};
+        monitor.receive(2, 60); // out of range
+        monitor.receive(2, buf, 60);
+        monitor.unwatch(2);
+        CHECK(monitor.advance(149) == 0);
+        CHECK(monitor.advance(150) == 1);
+    }
+
+    TEST_CASE("stale signals read as invalid in the store") {
+        can_LatestStore<4> store;
+        can_DeadlineMonitor<4> monitor(&store);
+        const can_Signal speed = {0, 16, true, false, 0.01f, 0.0f};
+        monitor.watch(2, 30000, 0); // microseconds
+
+        uint8_t buf[8] = {0};
+        can_setSignal(buf, 88.5f, speed);
+        float value = 0.0f;
+        CHECK_FALSE(store.getSignal(2, speed, value));
+        for (uint64_t t = 10000; t <= 50000; t += 10000) {
+            monitor.receive(2, buf, t);
+            monitor.advance(t);
+        }
+        CHECK(store.valid(2));
+        CHECK(store.getSignal(2, speed, value));
+        CHECK(value == doctest::Approx(88.5f));
+
+        monitor.advance(80000);
+        CHECK(monitor.expired(2));
+        CHECK_FALSE(store.valid(2));
+        value = 0.0f;
+        CHECK_FALSE(store.getSignal(2, speed, value));
+        CHECK(value == 0.0f);
+        uint8_t last[8] = {0};
+        CHECK_FALSE(store.read(2, last));
+        CHECK(can_getSignal(last, speed) == doctest::Approx(88.5f)); // last frame still there
+
+        monitor.receive(2, buf, 90000);
+        CHECK_FALSE(monitor.expired(2));
+        CHECK(store.getSignal(2, speed, value));
+    }
+}
@@ -0,0 +1,159 @@
+#include "../can_e2e.hpp"
+#include "../can_staging.hpp"
+
+#include "doctest.h"
+
+#include <cstdlib>
+
+namespace {
+uint16_t bitwiseCrc(const uint8_t* data, const size_t size, uint16_t crc, const int width, const uint16_t poly) {
+    const uint16_t top = static_cast<uint16_t>(1u << (width - 1));
+    const uint16_t mask = static_cast<uint16_t>((1u << width) - 1u);
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= static_cast<uint16_t>(data[i] << (width - 8));
+        for (int bit = 0; bit < 8; ++bit)
+            crc = static_cast<uint16_t>((crc & top ? (crc << 1) ^ poly : crc << 1) & mask);
+    }
+    return crc;
+}
+} // namespace
+
+TEST_SUITE("E2E") {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+    TEST_CASE("CRC check values") {
+        CHECK((can_crc8Update(0xFF, check, 9) ^ 0xFF) == 0x4B);
+        CHECK((can_crc8h2fUpdate(0xFF, check, 9) ^ 0xFF) == 0xDF);
+        CHECK(can_crc16Update(0xFFFF, check, 9) == 0x29B1);
+    }
+
+    TEST_CASE("sliced CRCs match the bitwise definition") {
+        std::srand(11);
+        uint8_t data[67];
+        for (size_t size = 0; size < sizeof(data); ++size) {
+            for (size_t i = 0; i < size; ++i)
+                data[i] = static_cast<uint8_t>(std::rand());
+            const uint8_t start8 = static_cast<uint8_t>(std::rand());
+            const uint16_t start16 = static_cast<uint16_t>(std::rand());
+            CHECK(can_crc8Update(start8, data, size) == bitwiseCrc(data, size, start8, 8, 0x1D));
+            CHECK(can_crc8h2fUpdate(start8, data, size) == bitwiseCrc(data, size, start8, 8, 0x2F));
+            CHECK(can_crc16Update(start16, data, size) == bitwiseCrc(data, size, start16, 16, 0x1021));
+        }
+    }
+
+    TEST_CASE("profile 1 layout") {
+        const can_E2EConfig config = {CAN_E2E_P01, 8, 0x0123, nullptr, 0, 8, 1};
+        can_E2EState state = {5, false};
+        uint8_t data[8] = {0x00, 0xA0, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+        REQUIRE(can_e2eProtect(config, state, data, 8));
+        CHECK(data[1] == 0xA5); // counter in the low nibble, high nibble kept
+        const uint8_t covered[] = {0x23, 0x01, 0xA5, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+        CHECK(data[0] == bitwiseCrc(covered, sizeof(covered), 0x00, 8, 0x1D));
+        CHECK(state.counter == 6);
+
+        state.counter = 14;
+        can_e2eProtect(config, state, data, 8);
+        CHECK(state.counter == 0); // 15 is not a valid counter
+    }
+
+    TEST_CASE("round trip and sequence tracking") {
+        const uint8_t ids[16] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xF0, 0x0F};
+        const can_E2EConfig configs[] = {
+            {CAN_E2E_P01, 8, 0x0456, nullptr, 7, 52, 2},
+            {CAN_E2E_P02, 8, 0, ids, 0, 8, 2},
+            {CAN_E2E_P05, 8, 0x0789, nullptr, 0, 0, 2},
+            {CAN_E2E_P11, 6, 0x0ABC, nullptr, 0, 8, 2},
+        };
+        for (const can_E2EConfig& config : configs) {
+            CAPTURE(config.profile);
+            can_E2EState tx = {0, false}, rx = {0, false};
+            uint8_t frames[20][8];
+            for (int i = 0; i < 20; ++i) {
+                for (int b = 0; b < 8; ++b)
+                    frames[i][b] = static_cast<uint8_t>(i * 8 + b);
+                REQUIRE(can_e2eProtect(config, tx, frames[i], 8));
+            }
+            CHECK(can_e2eCheck(config, rx, frames[0], config.length) == CAN_E2E_INITIAL);
+            CHECK(can_e2eCheck(config, rx, frames[1], config.length) == CAN_E2E_OK);
+            CHECK(can_e2eCheck(config, rx, frames[1], config.length) == CAN_E2E_REPEATED);
+            CHECK(can_e2eCheck(config, rx, frames[3], config.length) == CAN_E2E_OK_SOME_LOST);
+            CHECK(can_e2eCheck(config, rx, frames[7], config.length) == CAN_E2E_WRONG_SEQUENCE);
+            CHECK(can_e2eCheck(config, rx, frames[8], config.length) == CAN_E2E_OK);
+            CHECK(can_e2eCheck(config, rx, frames[8], config.length - 1) == CAN_E2E_ERROR);
+
+            frames[9][config.length - 1] ^= 0x10;
+            CHECK(can_e2eCheck(config, rx, frames[9], config.length) == CAN_E2E_ERROR);
+            CHECK(can_e2eCheck(config, rx, frames[10], config.length) == CAN_E2E_OK_SOME_LOST);
+        }
+    }
+
+    TEST_CASE("malformed configurations are rejected") {
+        const uint8_t ids[16] = {0};
+        const can_E2EConfig bad[] = {
+            {CAN_E2E_P01, 8, 0x0123, nullptr, 8, 8, 1},  // CRC past the payload
+            {CAN_E2E_P11, 8, 0x0123, nullptr, 0, 64, 1}, // counter past the payload
+            {CAN_E2E_P01, 8, 0x0123, nullptr, 0, 14, 1}, // counter straddles two bytes
+            {CAN_E2E_P01, 8, 0x0123, nullptr, 1, 8, 1},  // counter inside the CRC byte
+            {CAN_E2E_P05, 8, 0x1234, nullptr, 6, 0, 1},  // counter past the payload
+            {CAN_E2E_P02, 8, 0, nullptr, 0, 8, 1},       // no DataID list
+            {CAN_E2E_P02, 1, 0, ids, 0, 8, 1},           // no room for the counter
+        };
+        for (const can_E2EConfig& config : bad) {
+            CAPTURE(config.profile);
+            CHECK_FALSE(can_e2eValid(config));
+            uint8_t data[8] = {0};
+            can_E2EProtector protector(config);
+            CHECK_FALSE(protector.protect(data, 8));
+            can_E2EChecker checker(config);
+            CHECK(checker.check(data, config.length) == CAN_E2E_ERROR);
+        }
+        const can_E2EConfig good = {CAN_E2E_P05, 8, 0x1234, nullptr, 5, 0, 1};
+        CHECK(can_e2eValid(good));
+    }
+
+    TEST_CASE("protection while packing and checking before decode") {
+        const can_Signal signals[] = {
+            {24, 12, true, false, 0.5f, 0.0f},
+            {36, 12, true, true, 1.0f, 0.0f},
+        };
+        const can_E2EConfig config = {CAN_E2E_P05, 8, 0x1234, nullptr, 0, 0, 1};
+        can_MessageStage<4> stage(signals, 2);
+        can_E2EProtector protector(config);
+        can_E2EChecker checker(config);
+
+        uint8_t frame[8];
+        float values[2] = {0.0f, 0.0f};
+        for (int cycle = 0; cycle < 300; ++cycle) {
+            stage.set(0, 100.0f + (cycle % 7));
+            stage.set(1, -50.0f);
+            stage.pack(frame, protector);
+            CHECK(frame[2] == static_cast<uint8_t>(cycle));
+            const can_E2EStatus status = checker.decode(frame, 8, signals, 2, values);
+            CHECK(status == (cycle == 0 ? CAN_E2E_INITIAL : CAN_E2E_OK));
+            CHECK(values[0] == doctest::Approx(100.0f + (cycle % 7)));
+            CHECK(values[1] == doctest::Approx(-50.0f));
+        }
+        // Counter and CRC are not part of the staged payload
+        CHECK(stage.data()[0] == 0);
+        CHECK(stage.data()[2] == 0);
+
+        stage.set(0, 7.0f);
+        CHECK(stage.pack(frame, protector) == CAN_STAGE_CHANGED);
+        frame[4] ^= 1;
+        CHECK(checker.decode(frame, 8, signals, 2, values) == CAN_E2E_ERROR);
+        CHECK(values[0] == doctest::Approx(105.0f)); // corrupted frame not decoded
+        CHECK(stage.pack(frame, protector) == CAN_STAGE_UNCHANGED);
+    }
+
+    TEST_CASE("a frame that cannot be protected is not ready") {
+        const can_Signal signals[] = {{24, 12, true, false, 0.5f, 0.0f}};
+        const can_E2EConfig config = {CAN_E2E_P05, 8, 0x1234, nullptr, 6, 0, 1}; // counter past the payload
+        can_MessageStage<1> stage(signals, 1);
+        can_E2EProtector protector(config);
+        uint8_t frame[8];
+        stage.set(0, 100.0f);
+        CHECK(stage.pack(frame, protector) == CAN_STAGE_UNPROTECTED);
+        CHECK(stage.changed());
+        CHECK(stage.pack(frame, protector) == CAN_STAGE_UNPROTECTED);
+    }
+}
@@ -0,0 +1,70 @@
+#include "../can_gateway.hpp"
+
+#include "doctest.h"
+
+#include <cstdlib>
+
+TEST_SUITE("Gateway") {
+    TEST_CASE("fused routes match getSignal/setSignal") {
+        // Source messages 0 and 1 on bus A, destination messages 0..2 on bus B
+        const can_Route routes[] = {
+            {0, {0, 16, true, false, 0.125f, 0.0f}, 1, {0, 16, true, false, 0.125f, 0.0f}},     // identical layout
+            {0, {16, 8, true, false, 1.0f, 0.0f}, 1, {16, 8, true, false, 1.0f, 0.0f}},         // merges into the same copy
+            {0, {24, 12, true, true, 0.1f, 0.0f}, 1, {40, 16, true, true, 0.1f, 0.0f}},         // moved and sign-widened
+            {0, {56, 16, false, false, 1.0f, 0.0f}, 2, {8, 16, true, false, 1.0f, 0.0f}},       // Motorola to Intel
+            {0, {36, 4, true, false, 1.0f, 0.0f}, 2, {44, 4, false, false, 1.0f, 0.0f}},        // Intel to Motorola
+            {1, {0, 10, true, false, 0.5f, -100.0f}, 2, {32, 8, true, false, 2.0f, -100.0f}},   // rescaled
+            {1, {40, 16, false, false, 0.01f, 0.0f}, 0, {40, 16, false, false, 0.01f, 0.0f}},   // identical Motorola
+            {1, {20, 3, true, false, 1.0f, 0.0f}, 1, {60, 3, true, false, 1.0f, 0.0f}},         // second source into message 1
+        };
+        const size_t ROUTES = sizeof(routes) / sizeof(routes[0]);
+
+        can_Gateway<16> gateway;
+        for (size_t i = 0; i < ROUTES; ++i)
+            CHECK(gateway.add(routes[i]) == static_cast<int>(i));
+        gateway.compile();
+
+        std::srand(5);
+        uint8_t fused[3][8], reference[3][8];
+        for (size_t m = 0; m < 3; ++m) {
+            for (size_t b = 0; b < 8; ++b)
+                fused[m][b] = reference[m][b] = static_cast<uint8_t>(std::rand());
+        }
+
+        for (int frame = 0; frame < 1000; ++frame) {
+            const size_t source = std::rand() % 2;
+            uint8_t src[8];
+            for (size_t b = 0; b < 8; ++b)
+                src[b] = static_cast<uint8_t>(std::rand());
+
+            size_t touched[3];
+            const size_t n = gateway.apply(source, src, fused, touched);
+            CHECK(n == (source == 0 ? 2u : 3u));
+            CHECK(touched[0] < touched[n - 1]);
+
+            for (size_t i = 0; i < ROUTES; ++i) {
+                const can_Route& r = routes[i];
+                if (r.srcMessage != source)
+                    continue;
+                if (r.src.factor == r.dst.factor && r.src.offset == r.dst.offset)
+                    can_setRawSignal(reference[r.dstMessage], can_getRawSignal(src, r.src), r.dst);
+                else
+                    can_setSignal(reference[r.dstMessage], can_getSignal(src, r.src), r.dst);
+            }
+            if (std::memcmp(fused, reference, sizeof(fused)) != 0)
+                FAIL("frame " << frame);
+        }
+    }
+
+    TEST_CASE("unrouted source touches nothing") {
+        can_Gateway<2> gateway;
+        const can_Route route = {3, {0, 8, true, false, 1.0f, 0.0f}, 0, {8, 8, true, false, 1.0f, 0.0f}};
+        gateway.add(route);
+        uint8_t src[8] = {0x5A};
+        uint8_t dst[1][8] = {{0}};
+        CHECK(gateway.apply(2, src, dst) == 0);
+        CHECK(gateway.apply(4, src, dst) == 0);
+        CHECK(gateway.apply(3, src, dst) == 1);
+        CHECK(dst[0][1] == 0x5A);
+    }
+}
@@ -0,0 +1,180 @@
+#include "../can_index.hpp"
+
+#include "doctest.h"
+
+static void checkIndex(const can_PcapFormat format, const char* logPath) {
+    const char* indexPath = "Test/test_tmp.cidx";
+    const uint32_t ids[5] = {0x100, 0x101, 0x200, 0x18FEF100, 0x7FF};
+    {
+        can_PcapWriter writer(logPath, format);
+        REQUIRE(writer.isOpen());
+        can_Frame frame;
+        std::memset(&frame, 0, sizeof(frame));
+        frame.len = 8;
+        for (uint32_t i = 0; i < 100000; ++i) {
+            // 0x7FF only shows up in a short burst in the middle of the log
+            const uint32_t id = (i >= 50000 && i < 50100) ? ids[4] : ids[i % 4];
+            frame.id = id;
+            frame.flags = id > 0x7FF ? CAN_FRAME_EXTENDED : 0;
+            frame.timestamp = 1000000 + i * 100ULL;
+            can_setSignal<uint32_t>(can_frameData(frame), i, 0, 32, true);
+            writer.write(frame);
+        }
+    }
+
+    REQUIRE(can_buildIndex(logPath, indexPath, 4, 256));
+    can_LogIndex index;
+    REQUIRE(index.open(indexPath));
+    CHECK(index.blockCount() >= 100000 / 256);
+
+    can_PcapReader reader;
+    REQUIRE(reader.open(logPath));
+
+    std::vector<uint32_t> blocks;
+    REQUIRE(index.postings(0x7FF, false, blocks));
+    CHECK(blocks.size() <= 2);
+    std::vector<can_Frame> frames;
+    REQUIRE(can_extractMessage(reader, index, 0x7FF, false, frames));
+    REQUIRE(frames.size() == 100);
+    CHECK(can_getSignal<uint32_t>(can_frameData(frames[0]), 0, 32, true) == 50000);
+
+    // Every frame of a busy message is found exactly once
+    frames.clear();
+    REQUIRE(can_extractMessage(reader, index, 0x18FEF100, true, frames));
+    REQUIRE(frames.size() == 24975);
+    for (size_t i = 1; i < frames.size(); ++i)
+        CHECK_MESSAGE(frames[i].timestamp > frames[i - 1].timestamp, i);
+    CHECK_FALSE(index.postings(0x18FEF100, false, blocks));
+
+    const size_t b = index.findTime(1000000 + 70000 * 100ULL);
+    REQUIRE(b < index.blockCount());
+    CHECK(index.block(b).minTimestamp <= 1000000 + 70000 * 100ULL);
+    CHECK(index.block(b).maxTimestamp >= 1000000 + 70000 * 100ULL);
+
+    reader.close();
+    index.close();
+    std::remove(logPath);
+    std::remove(indexPath);
+}
+
+TEST_SUITE("Log index") {
+    TEST_CASE("varint") {
+        std::vector<uint8_t> buf;
+        can_putVarint(buf, 0);
+        can_putVarint(buf, 300);
+        can_putVarint(buf, 0xFFFFFFFFu);
+        const uint8_t* p = buf.data();
+        uint32_t v;
+        CHECK((can_getVarint(p, buf.data() + buf.size(), v) && v == 0));
+        CHECK((can_getVarint(p, buf.data() + buf.size(), v) && v == 300));
+        CHECK((can_getVarint(p, buf.data() + buf.size(), v) && v == 0xFFFFFFFFu));
+        CHECK(p == buf.data() + buf.size());
+    }
+
+    TEST_CASE("corrupt posting lists are rejected") {
+        const char* logPath = "Test/test_tmp_idx_bad.pcap";
+        const char* indexPath = "Test/test_tmp_bad.cidx";
+        {
+            can_PcapWriter writer(logPath, CAN_PCAP);
+            can_Frame frame;
+            std::memset(&frame, 0, sizeof(frame));
+            frame.len = 8;
+            for (uint32_t i = 0; i < 100; ++i) {
+                frame.id = 0x100 + i % 2;
+                frame.timestamp = i * 100ULL;
+                writer.write(frame);
+            }
+        }
+        REQUIRE(can_buildIndex(logPath, indexPath, 1, 16));
+
+        std::vector<uint8_t> bytes;
+        {
+            can_MappedFile file;
+            REQUIRE(file.open(indexPath));
+            bytes.assign(file.data(), file.data() + file.size());
+        }
+        uint32_t header[4];
+        std::memcpy(header, bytes.data(), sizeof(header));
+        REQUIRE(header[3] == 2);
+        const size_t entryAt = 16 + header[2] * sizeof(can_IndexBlock);
+        const size_t listsAt = entryAt + 2 * sizeof(can_IndexEntry);
+
+        // Rewrite one field of the first entry, or its first posting, and reload
+        const auto check = [&](const size_t at, const void* value, const size_t size) {
+            std::vector<uint8_t> copy(bytes);
+            std::memcpy(copy.data() + at, value, size);
+            std::FILE* f = std::fopen(indexPath, "wb");
+            REQUIRE(f);
+            std::fwrite(copy.data(), 1, copy.size(), f);
+            std::fclose(f);
+            can_LogIndex index;
+            REQUIRE(index.open(indexPath));
+            std::vector<uint32_t> blocks;
+            CHECK_FALSE(index.postings(0x100, false, blocks));
+            can_PcapReader reader;
+            REQUIRE(reader.open(logPath));
+            std::vector<can_Frame> frames;
+            CHECK_FALSE(can_extractMessage(reader, index, 0x100, false, frames));
+        };
+        const uint64_t huge = 0xFFFFFFFFFFFFFFF0ULL;
+        check(entryAt + offsetof(can_IndexEntry, postingOffset), &huge, 8);
+        check(entryAt + offsetof(can_IndexEntry, postingBytes), &huge, 8);
+        const uint8_t farBlock = 0x7F;
+        check(listsAt, &farBlock, 1);
+
+        std::remove(logPath);
+        std::remove(indexPath);
+    }
+
+    TEST_CASE("sharded PCAPNG index") {
+        checkIndex(CAN_PCAPNG, "Test/test_tmp_idx.pcapng");
+    }
+
+    TEST_CASE("sharded PCAP index") {
+        checkIndex(CAN_PCAP, "Test/test_tmp_idx.pcap");
+    }
+
+    TEST_CASE("interfaces declared mid-file reach every shard") {
+        const char* logPath = "Test/test_tmp_idx_late.pcapng";
+        const char* indexPath = "Test/test_tmp_late.cidx";
+        {
+            // The writer declares bus 1 when its first frame shows up, far into the log
+            can_PcapWriter writer(logPath, CAN_PCAPNG);
+            REQUIRE(writer.isOpen());
+            can_Frame frame;
+            std::memset(&frame, 0, sizeof(frame));
+            frame.len = 8;
+            for (uint32_t i = 0; i < 100000; ++i) {
+                frame.bus = (i >= 30000 && i % 2) ? 1 : 0;
+                frame.id = frame.bus ? 0x300 : 0x100;
+                frame.timestamp = i * 100ULL;
+                can_setSignal<uint32_t>(can_frameData(frame), i, 0, 32, true);
+                writer.write(frame);
+            }
+        }
+
+        can_PcapReader reader;
+        REQUIRE(reader.open(logPath));
+        REQUIRE(reader.headerBlocks().size() == 1);
+
+        REQUIRE(can_buildIndex(logPath, indexPath, 4, 256));
+        can_LogIndex index;
+        REQUIRE(index.open(indexPath));
+        size_t frames = 0;
+        for (size_t b = 0; b < index.blockCount(); ++b)
+            frames += index.block(b).frames;
+        CHECK(frames == 100000);
+
+        std::vector<can_Frame> out;
+        REQUIRE(can_extractMessage(reader, index, 0x300, false, out));
+        REQUIRE(out.size() == 35000);
+        CHECK(out[0].bus == 1);
+        CHECK(can_getSignal<uint32_t>(can_frameData(out[0]), 0, 32, true) == 30001);
+        CHECK(can_getSignal<uint32_t>(can_frameData(out.back()), 0, 32, true) == 99999);
+
+        reader.close();
+        index.close();
+        std::remove(logPath);
+        std::remove(indexPath);
+    }
+}
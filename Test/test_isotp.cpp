@@ -0,0 +1,272 @@
+#include "../can_isotp.hpp"
+
+#include "doctest.h"
+
+#include <deque>
+#include <vector>
+
+namespace {
+struct WireFrame {
+    int to;
+    uint32_t id;
+    bool extended;
+    uint8_t data[8];
+};
+
+struct Wire {
+    std::deque<WireFrame> frames;
+    bool dropFlowControl = false;
+};
+
+struct Port {
+    Wire* wire;
+    int peer;
+};
+
+bool wireTx(void* context, const uint32_t id, const bool extended, const uint8_t (&data)[8], uint8_t) {
+    Port& port = *static_cast<Port*>(context);
+    if (port.wire->dropFlowControl && (data[0] >> 4) == 3)
+        return true;
+    WireFrame f;
+    f.to = port.peer;
+    f.id = id;
+    f.extended = extended;
+    std::memcpy(f.data, data, 8);
+    port.wire->frames.push_back(f);
+    return true;
+}
+
+struct Sink {
+    std::vector<std::vector<uint8_t> > messages;
+    std::vector<size_t> channels;
+    std::vector<can_IsoTpResult> sent;
+    std::vector<can_IsoTpResult> errors;
+    uint8_t pool[8][512];
+};
+
+void onReceive(void* context, const size_t channel, const uint8_t* data, const size_t size) {
+    Sink& sink = *static_cast<Sink*>(context);
+    sink.messages.push_back(std::vector<uint8_t>(data, data + size));
+    sink.channels.push_back(channel);
+}
+
+void onSent(void* context, size_t, const can_IsoTpResult result) { static_cast<Sink*>(context)->sent.push_back(result); }
+void onError(void* context, size_t, const can_IsoTpResult result) { static_cast<Sink*>(context)->errors.push_back(result); }
+
+uint8_t* pooled(void* context, const size_t channel, const size_t size) {
+    return size <= 512 ? static_cast<Sink*>(context)->pool[channel % 8] : nullptr;
+}
+
+template <size_t N>
+void run(Wire& wire, can_IsoTp<N>* (&stacks)[2], const uint64_t from, const uint64_t until) {
+    for (uint64_t now = from; now <= until; ++now) {
+        stacks[0]->advance(now);
+        stacks[1]->advance(now);
+        while (!wire.frames.empty()) {
+            const WireFrame f = wire.frames.front();
+            wire.frames.pop_front();
+            stacks[f.to]->onFrame(f.id, f.extended, f.data, 8, now);
+        }
+    }
+}
+
+std::vector<uint8_t> pattern(const size_t size) {
+    std::vector<uint8_t> out(size);
+    for (size_t i = 0; i < size; ++i)
+        out[i] = static_cast<uint8_t>(i * 13 + 5);
+    return out;
+}
+} // namespace
+
+TEST_SUITE("ISO-TP") {
+    TEST_CASE("segmented transfer with block size and STmin") {
+        Wire wire;
+        Port toTester = {&wire, 0}, toEcu = {&wire, 1};
+        can_IsoTp<1> tester(&wireTx, &toEcu), ecu(&wireTx, &toTester);
+        Sink testerSink, ecuSink;
+        tester.setCallbacks(&onReceive, &onSent, &onError, nullptr, &testerSink);
+        ecu.setCallbacks(&onReceive, &onSent, &onError, nullptr, &ecuSink);
+
+        uint8_t rx[1024];
+        const can_IsoTpConfig testerCfg = {0x7E8, 0x7E0, false, 4, 2};
+        const can_IsoTpConfig ecuCfg = {0x7E0, 0x7E8, false, 0, 0};
+        CHECK(tester.addChannel(testerCfg, rx, sizeof(rx)) == 0);
+        CHECK(ecu.addChannel(ecuCfg) == 0);
+
+        // ECU answers with a 300 byte response: 1 FF + 42 CF at 2 ms each, in blocks of 4, done at 82 ms
+        const std::vector<uint8_t> response = pattern(300);
+        CHECK(ecu.send(0, response.data(), response.size()));
+        CHECK_FALSE(ecu.send(0, response.data(), response.size()));
+        can_IsoTp<1>* stacks[2] = {&tester, &ecu};
+        run(wire, stacks, 0, 81);
+        CHECK(testerSink.messages.empty());
+        run(wire, stacks, 82, 200);
+
+        REQUIRE(testerSink.messages.size() == 1);
+        CHECK(testerSink.messages[0] == response);
+        REQUIRE(ecuSink.sent.size() == 1);
+        CHECK(ecuSink.sent[0] == CAN_ISOTP_OK);
+        CHECK_FALSE(ecu.busy(0));
+
+        // Signals decode straight out of the reassembled buffer
+        const can_Signal sig = {250 * 8, 16, true, false, 1.0f, 0.0f};
+        CHECK(can_getRawSignal(rx, 300, sig) == (response[250] | (response[251] << 8)));
+
+        // Single frames go straight through
+        const uint8_t request[] = {0x22, 0xF1, 0x90};
+        CHECK(tester.send(0, request, sizeof(request)));
+        run(wire, stacks, 201, 201);
+        REQUIRE(ecuSink.messages.size() == 1);
+        CHECK(ecuSink.messages[0] == std::vector<uint8_t>(request, request + 3));
+    }
+
+    TEST_CASE("sub-millisecond STmin still spaces frames at 1 tick per ms") {
+        Wire wire;
+        Port toTester = {&wire, 0}, toEcu = {&wire, 1};
+        can_IsoTp<1> tester(&wireTx, &toEcu), ecu(&wireTx, &toTester);
+        Sink testerSink, ecuSink;
+        tester.setCallbacks(&onReceive, &onSent, &onError, nullptr, &testerSink);
+        ecu.setCallbacks(&onReceive, &onSent, &onError, nullptr, &ecuSink);
+
+        uint8_t rx[1024];
+        const can_IsoTpConfig testerCfg = {0x7E8, 0x7E0, false, 0, 0xF5}; // 500 us
+        const can_IsoTpConfig ecuCfg = {0x7E0, 0x7E8, false, 0, 0};
+        CHECK(tester.addChannel(testerCfg, rx, sizeof(rx)) == 0);
+        CHECK(ecu.addChannel(ecuCfg) == 0);
+
+        // 1 FF + 42 CF, one tick apart rather than all at once
+        const std::vector<uint8_t> response = pattern(300);
+        CHECK(ecu.send(0, response.data(), response.size()));
+        can_IsoTp<1>* stacks[2] = {&tester, &ecu};
+        run(wire, stacks, 0, 40);
+        CHECK(testerSink.messages.empty());
+        run(wire, stacks, 41, 41);
+        REQUIRE(testerSink.messages.size() == 1);
+        CHECK(testerSink.messages[0] == response);
+    }
+
+    TEST_CASE("parallel channels into pooled buffers") {
+        Wire wire;
+        Port toA = {&wire, 0}, toB = {&wire, 1};
+        can_IsoTp<8> a(&wireTx, &toB), b(&wireTx, &toA);
+        Sink aSink, bSink;
+        a.setCallbacks(&onReceive, &onSent, &onError, nullptr, &aSink);
+        b.setCallbacks(&onReceive, &onSent, &onError, &pooled, &bSink);
+
+        std::vector<std::vector<uint8_t> > payloads;
+        for (uint32_t i = 0; i < 8; ++i) {
+            // Added out of ID order to exercise the sorted lookup
+            const uint32_t node = (i * 5) % 8;
+            const can_IsoTpConfig aCfg = {0x18DAF100 + node, 0x18DA00F1 + (node << 8), true, 0, 0};
+            const can_IsoTpConfig bCfg = {0x18DA00F1 + (node << 8), 0x18DAF100 + node, true, 2, 1};
+            CHECK(a.addChannel(aCfg) == static_cast<int>(i));
+            CHECK(b.addChannel(bCfg) == static_cast<int>(i));
+            payloads.push_back(pattern(40 + 50 * i));
+        }
+        for (size_t i = 0; i < 8; ++i)
+            CHECK(a.send(i, payloads[i].data(), payloads[i].size()));
+
+        can_IsoTp<8>* stacks[2] = {&a, &b};
+        run(wire, stacks, 0, 200);
+
+        REQUIRE(bSink.messages.size() == 8);
+        for (size_t k = 0; k < 8; ++k)
+            CHECK(bSink.messages[k] == payloads[bSink.channels[k]]);
+        CHECK(aSink.sent.size() == 8);
+        CHECK(bSink.errors.empty());
+    }
+
+    TEST_CASE("overflow, timeouts and long messages") {
+        Wire wire;
+        Port toA = {&wire, 0}, toB = {&wire, 1};
+        can_IsoTp<1> a(&wireTx, &toB), b(&wireTx, &toA);
+        Sink aSink, bSink;
+        a.setCallbacks(&onReceive, &onSent, &onError, nullptr, &aSink);
+        b.setCallbacks(&onReceive, &onSent, &onError, nullptr, &bSink);
+        static uint8_t rx[5000];
+        const can_IsoTpConfig aCfg = {0x701, 0x700, false, 0, 0};
+        const can_IsoTpConfig bCfg = {0x700, 0x701, false, 0, 0};
+        a.addChannel(aCfg);
+        b.addChannel(bCfg, rx, sizeof(rx));
+        can_IsoTp<1>* stacks[2] = {&a, &b};
+
+        const std::vector<uint8_t> tooBig = pattern(6000);
+        a.send(0, tooBig.data(), tooBig.size());
+        run(wire, stacks, 0, 10);
+        REQUIRE(aSink.sent.size() == 1);
+        CHECK(aSink.sent[0] == CAN_ISOTP_OVERFLOW);
+
+        // Above 4095 bytes the first frame uses the 32-bit length escape
+        const std::vector<uint8_t> big = pattern(5000);
+        a.send(0, big.data(), big.size());
+        run(wire, stacks, 11, 20);
+        REQUIRE(bSink.messages.size() == 1);
+        CHECK(bSink.messages[0] == big);
+
+        // Missing flow control: the sender gives up after N_Bs
+        wire.dropFlowControl = true;
+        a.send(0, big.data(), 100);
+        run(wire, stacks, 21, 1019);
+        CHECK(aSink.sent.size() == 2);
+        run(wire, stacks, 1020, 1021);
+        REQUIRE(aSink.sent.size() == 3);
+        CHECK(aSink.sent[2] == CAN_ISOTP_TIMEOUT);
+        REQUIRE(bSink.errors.size() == 1); // and the receiver stopped waiting for consecutive frames
+        CHECK(bSink.errors[0] == CAN_ISOTP_TIMEOUT);
+    }
+
+    TEST_CASE("STmin paced from each frame's own tick") {
+        Wire wire;
+        Port toTester = {&wire, 0}, toEcu = {&wire, 1};
+        can_IsoTp<1> tester(&wireTx, &toEcu), ecu(&wireTx, &toTester);
+        uint8_t rx[1024];
+        const can_IsoTpConfig testerCfg = {0x7E8, 0x7E0, false, 0, 10};
+        const can_IsoTpConfig ecuCfg = {0x7E0, 0x7E8, false, 0, 0};
+        tester.addChannel(testerCfg, rx, sizeof(rx));
+        ecu.addChannel(ecuCfg);
+
+        // First frame, flow control and the first consecutive frame at t = 0
+        const std::vector<uint8_t> response = pattern(300);
+        REQUIRE(ecu.send(0, response.data(), response.size()));
+        tester.onFrame(wire.frames[0].id, false, wire.frames[0].data, 8, 0);
+        ecu.onFrame(wire.frames[1].id, false, wire.frames[1].data, 8, 0);
+        REQUIRE(wire.frames.size() == 3);
+        wire.frames.clear();
+
+        // One late call to advance still sends every frame that fell due, 10 ms apart
+        ecu.advance(100);
+        CHECK(wire.frames.size() == 10);
+        wire.frames.clear();
+        ecu.advance(109);
+        CHECK(wire.frames.empty());
+        ecu.advance(110);
+        CHECK(wire.frames.size() == 1);
+    }
+
+    TEST_CASE("flow control WAITs are limited") {
+        Wire wire;
+        Port toTester = {&wire, 0};
+        can_IsoTp<1> ecu(&wireTx, &toTester);
+        Sink sink;
+        ecu.setCallbacks(&onReceive, &onSent, &onError, nullptr, &sink);
+        ecu.setMaxWaits(2);
+        const can_IsoTpConfig cfg = {0x7E0, 0x7E8, false, 0, 0};
+        ecu.addChannel(cfg);
+
+        const std::vector<uint8_t> message = pattern(100);
+        const uint8_t wait[8] = {0x31, 0, 0, 0, 0, 0, 0, 0};
+        const uint8_t clear[8] = {0x30, 2, 0, 0, 0, 0, 0, 0};
+        REQUIRE(ecu.send(0, message.data(), message.size()));
+        ecu.onFrame(0x7E0, false, wait, 8, 10);
+        ecu.onFrame(0x7E0, false, wait, 8, 20);
+        ecu.onFrame(0x7E0, false, clear, 8, 30); // resets the count
+        ecu.onFrame(0x7E0, false, wait, 8, 40);
+        ecu.onFrame(0x7E0, false, wait, 8, 50);
+        CHECK(sink.sent.empty());
+        CHECK(ecu.busy(0));
+        ecu.onFrame(0x7E0, false, wait, 8, 60);
+        REQUIRE(sink.sent.size() == 1);
+        CHECK(sink.sent[0] == CAN_ISOTP_WAIT);
+        CHECK_FALSE(ecu.busy(0));
+    }
+}
@@ -0,0 +1,109 @@
+#include "../can_j1939.hpp"
+
+#include "doctest.h"
+
+TEST_SUITE("J1939") {
+    // EEC1 (PGN 61444) and ET1 (PGN 65262), positions per J1939-71
+    const can_J1939Spn spns[] = {
+        {190, 61444, {24, 16, true, false, 0.125f, 0.0f}},      // engine speed, rpm
+        {513, 61444, {16, 8, true, false, 1.0f, -125.0f}},      // actual engine torque, %
+        {899, 61444, {0, 4, true, false, 1.0f, 0.0f}},          // engine torque mode
+        {110, 65262, {0, 8, true, false, 1.0f, -40.0f}},        // coolant temperature, degC
+        {175, 65262, {16, 16, true, false, 0.03125f, -273.0f}}, // oil temperature, degC
+    };
+
+    TEST_CASE("identifiers") {
+        const can_J1939Id eec1 = can_parseJ1939Id(0x0CF00400);
+        CHECK(eec1.pgn == 61444);
+        CHECK(eec1.priority == 3);
+        CHECK(eec1.source == 0x00);
+        CHECK(eec1.destination == CAN_J1939_GLOBAL);
+
+        const can_J1939Id request = can_parseJ1939Id(0x18EA17F9);
+        CHECK(request.pgn == 0xEA00);
+        CHECK(request.destination == 0x17);
+        CHECK(request.source == 0xF9);
+        CHECK(can_makeJ1939Id(6, 0xEA00, 0xF9, 0x17) == 0x18EA17F9);
+        CHECK(can_makeJ1939Id(3, 61444, 0x00) == 0x0CF00400);
+    }
+
+    TEST_CASE("status ranges") {
+        CHECK(can_spnStatus(0xFA, 8) == CAN_SPN_VALID);
+        CHECK(can_spnStatus(0xFB, 8) == CAN_SPN_RESERVED);
+        CHECK(can_spnStatus(0xFE, 8) == CAN_SPN_ERROR);
+        CHECK(can_spnStatus(0xFF, 8) == CAN_SPN_NOT_AVAILABLE);
+        CHECK(can_spnStatus(0xFAFF, 16) == CAN_SPN_VALID);
+        CHECK(can_spnStatus(0xFE12, 16) == CAN_SPN_ERROR);
+        CHECK(can_spnStatus(0xFF00, 16) == CAN_SPN_NOT_AVAILABLE);
+        CHECK(can_spnStatus(1, 2) == CAN_SPN_VALID);
+        CHECK(can_spnStatus(2, 2) == CAN_SPN_ERROR);
+        CHECK(can_spnStatus(3, 2) == CAN_SPN_NOT_AVAILABLE);
+        CHECK(can_spnStatus(0xE, 4) == CAN_SPN_ERROR);
+    }
+
+    TEST_CASE("lookups ignore priority and addresses") {
+        can_J1939Database<4, 8> db;
+        for (size_t i = 0; i < sizeof(spns) / sizeof(spns[0]); ++i)
+            CHECK(db.add(spns[i]) == static_cast<int>(i));
+        CHECK(db.add(spns[0]) == -1);
+        CHECK(db.messageCount() == 2);
+        CHECK(db.spnCount() == 5);
+
+        CHECK(db.findId(0x0CF00400) == db.findPgn(61444));
+        CHECK(db.findId(0x18F00417) == db.findPgn(61444)); // other priority and source
+        CHECK(db.findId(0x18FEEE00) == db.findPgn(65262));
+        CHECK(db.findId(0x18FEF100) == -1);
+        CHECK(db.findSpn(175) == 4);
+        CHECK(db.findSpn(1234) == -1);
+
+        uint8_t buf[8];
+        std::memset(buf, 0xFF, sizeof(buf));
+        can_setSignal<uint16_t>(buf, 1500 * 8, 24, 16, true);
+        can_setSignal<uint8_t>(buf, 125 + 42, 16, 8, true);
+        can_setSignal<uint8_t>(buf, 0xE, 0, 4, true);
+        float values[8];
+        can_SpnStatus status[8];
+        REQUIRE(db.decode(0x0CF00400, buf, values, status) == 3);
+        CHECK(values[0] == 1500.0f);
+        CHECK(status[0] == CAN_SPN_VALID);
+        CHECK(values[1] == 42.0f);
+        CHECK(status[2] == CAN_SPN_ERROR);
+        CHECK(db.decode(0x18FEF100, buf, values, status) == 0);
+    }
+
+    TEST_CASE("batch decode of one SPN") {
+        can_J1939Database<4, 8> db;
+        for (size_t i = 0; i < sizeof(spns) / sizeof(spns[0]); ++i)
+            db.add(spns[i]);
+
+        can_Frame frames[40];
+        std::memset(frames, 0, sizeof(frames));
+        for (int i = 0; i < 40; ++i) {
+            can_Frame& f = frames[i];
+            f.timestamp = 1000 * i;
+            f.flags = CAN_FRAME_EXTENDED;
+            f.len = 8;
+            std::memset(f.data, 0xFF, 8);
+            if (i % 2 == 0) {
+                f.id = can_makeJ1939Id(6, 65262, i % 4 == 0 ? 0x00 : 0x01);
+                can_setSignal<uint8_t>(can_frameData(f), static_cast<uint8_t>(40 + i), 0, 8, true);
+            } else {
+                f.id = can_makeJ1939Id(3, 61444, 0x00);
+            }
+        }
+        frames[4].data[0] = 0xFF; // sensor not available
+
+        float values[40];
+        can_SpnStatus status[40];
+        uint64_t ts[40];
+        CHECK(db.decodeBatch(frames, 40, 110, values, status, ts) == 20);
+        CHECK(values[1] == 2.0f);
+        CHECK(status[2] == CAN_SPN_NOT_AVAILABLE);
+        CHECK(ts[3] == 6000);
+
+        const size_t n = db.decodeBatch(frames, 40, 110, values, nullptr, ts, 0x01);
+        CHECK(n == 10);
+        CHECK(ts[0] == 2000);
+        CHECK(db.decodeBatch(frames, 40, 9999, values, status, ts) == 0);
+    }
+}
@@ -0,0 +1,251 @@
+#include "../can_j1939tp.hpp"
+
+#include "doctest.h"
+
+#include <vector>
+
+namespace {
+struct Received {
+    uint32_t pgn;
+    uint8_t source;
+    uint8_t destination;
+    std::vector<uint8_t> data;
+};
+
+void collect(void* context, const uint32_t pgn, const uint8_t source, const uint8_t destination, const uint8_t* data, const size_t size, uint64_t) {
+    Received r = {pgn, source, destination, std::vector<uint8_t>(data, data + size)};
+    static_cast<std::vector<Received>*>(context)->push_back(r);
+}
+
+struct TxLog {
+    std::vector<uint32_t> ids;
+    std::vector<std::vector<uint8_t> > frames;
+};
+
+bool recordTx(void* context, const uint32_t id, bool, const uint8_t (&data)[8], uint8_t) {
+    TxLog& log = *static_cast<TxLog*>(context);
+    log.ids.push_back(id);
+    log.frames.push_back(std::vector<uint8_t>(data, data + 8));
+    return true;
+}
+
+void control(uint8_t (&frame)[8], const uint8_t type, const size_t size, const uint8_t b4, const uint32_t pgn) {
+    const uint8_t data[8] = {type, static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8), static_cast<uint8_t>((size + 6) / 7),
+                             b4, static_cast<uint8_t>(pgn), static_cast<uint8_t>(pgn >> 8), static_cast<uint8_t>(pgn >> 16)};
+    std::memcpy(frame, data, 8);
+}
+
+void packet(uint8_t (&frame)[8], const std::vector<uint8_t>& payload, const uint8_t seq) {
+    std::memset(frame, 0xFF, 8);
+    frame[0] = seq;
+    for (size_t i = 0; i < 7 && (seq - 1) * 7u + i < payload.size(); ++i)
+        frame[1 + i] = payload[(seq - 1) * 7 + i];
+}
+
+std::vector<uint8_t> pattern(const size_t size, const uint8_t seed) {
+    std::vector<uint8_t> out(size);
+    for (size_t i = 0; i < size; ++i)
+        out[i] = static_cast<uint8_t>(i * 7 + seed);
+    return out;
+}
+} // namespace
+
+TEST_SUITE("J1939 transport") {
+    TEST_CASE("interleaved BAM transfers") {
+        std::vector<Received> received;
+        can_J1939Reassembler<4> tp(CAN_J1939_NULL_ADDR, &collect, &received);
+
+        const std::vector<uint8_t> big = pattern(CAN_J1939_TP_MAX, 1);
+        const std::vector<uint8_t> small = pattern(20, 9);
+        uint8_t frame[8];
+        uint64_t now = 0;
+        control(frame, CAN_TP_BAM, big.size(), 0xFF, 0xFEE3);
+        CHECK(tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x00), frame, 8, now));
+        control(frame, CAN_TP_BAM, small.size(), 0xFF, 0xFECA);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x03), frame, 8, now);
+        CHECK(tp.active() == 2);
+
+        for (int seq = 1; seq <= 255; ++seq) {
+            now += 50;
+            packet(frame, big, static_cast<uint8_t>(seq));
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x00), frame, 8, now);
+            if (seq <= 3) {
+                packet(frame, small, static_cast<uint8_t>(seq));
+                tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x03), frame, 8, now);
+            }
+        }
+        CHECK_FALSE(tp.onFrame(0x0CF00400, frame, 8, now));
+
+        REQUIRE(received.size() == 2);
+        CHECK(received[0].pgn == 0xFECA);
+        CHECK(received[0].source == 0x03);
+        CHECK(received[0].data == small);
+        CHECK(received[1].pgn == 0xFEE3);
+        CHECK(received[1].data == big);
+        CHECK(tp.active() == 0);
+
+        // Fields anywhere in the payload decode with the length-generic API
+        const can_Signal late = {1780 * 8, 16, true, false, 1.0f, 0.0f};
+        CHECK(can_getRawSignal(received[1].data.data(), received[1].data.size(), late) == (big[1780] | (big[1781] << 8)));
+        const can_Signal tail = {1784 * 8, 16, true, false, 1.0f, 0.0f};
+        CHECK(can_getRawSignal(received[1].data.data(), received[1].data.size(), tail) == big[1784]);
+    }
+
+    TEST_CASE("stalled transfers time out") {
+        std::vector<Received> received;
+        can_J1939Reassembler<1> tp(CAN_J1939_NULL_ADDR, &collect, &received, nullptr, nullptr, 1000); // microsecond clock
+        const std::vector<uint8_t> payload = pattern(30, 2);
+        uint8_t frame[8];
+        control(frame, CAN_TP_BAM, payload.size(), 0xFF, 0xFEEB);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x21), frame, 8, 1000000);
+        packet(frame, payload, 1);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x21), frame, 8, 1100000);
+        CHECK(tp.advance(1849999) == 0);
+        CHECK(tp.advance(1850000) == 1);
+        CHECK(tp.active() == 0);
+
+        // A late packet is ignored, and the pool slot is free for the next sender
+        packet(frame, payload, 2);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x21), frame, 8, 1900000);
+        control(frame, CAN_TP_BAM, payload.size(), 0xFF, 0xFEEB);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x22), frame, 8, 2000000);
+        CHECK(tp.active() == 1);
+        CHECK(received.empty());
+    }
+
+    TEST_CASE("connection mode as the receiver") {
+        std::vector<Received> received;
+        TxLog tx;
+        can_J1939Reassembler<2> tp(0x80, &collect, &received, &recordTx, &tx);
+        tp.setWindow(4);
+
+        const std::vector<uint8_t> payload = pattern(60, 3); // 9 packets
+        uint8_t frame[8];
+        control(frame, CAN_TP_RTS, payload.size(), 0xFF, 0xFECA);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x00, 0x80), frame, 8, 0);
+        REQUIRE(tx.frames.size() == 1);
+        CHECK(tx.ids[0] == can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x80, 0x00));
+        CHECK(tx.frames[0][0] == CAN_TP_CTS);
+        CHECK(tx.frames[0][1] == 4);
+        CHECK(tx.frames[0][2] == 1);
+
+        for (uint8_t seq = 1; seq <= 9; ++seq) {
+            packet(frame, payload, seq);
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x00, 0x80), frame, 8, seq * 10);
+        }
+        REQUIRE(tx.frames.size() == 4);
+        CHECK(tx.frames[1][0] == CAN_TP_CTS);
+        CHECK(tx.frames[1][2] == 5);
+        CHECK(tx.frames[2][1] == 1); // only packet 9 left
+        CHECK(tx.frames[2][2] == 9);
+        CHECK(tx.frames[3][0] == CAN_TP_EOMA);
+        CHECK(tx.frames[3][1] == 60);
+        REQUIRE(received.size() == 1);
+        CHECK(received[0].destination == 0x80);
+        CHECK(received[0].data == payload);
+
+        // Transfers to other nodes are not ours to follow
+        control(frame, CAN_TP_RTS, payload.size(), 0xFF, 0xFECA);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x00, 0x81), frame, 8, 200);
+        CHECK(tp.active() == 0);
+    }
+
+    TEST_CASE("sender packet limit applies to every window") {
+        std::vector<Received> received;
+        TxLog tx;
+        can_J1939Reassembler<1> tp(0x80, &collect, &received, &recordTx, &tx);
+        tp.setWindow(4);
+        const std::vector<uint8_t> payload = pattern(30, 5); // 5 packets
+        uint8_t frame[8];
+
+        // A limit of 0 means none
+        control(frame, CAN_TP_RTS, payload.size(), 0x00, 0xFECA);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x00, 0x80), frame, 8, 0);
+        REQUIRE(tx.frames.size() == 1);
+        CHECK(tx.frames[0][1] == 4);
+
+        tx.frames.clear();
+        control(frame, CAN_TP_RTS, payload.size(), 2, 0xFECA);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x00, 0x80), frame, 8, 10);
+        for (uint8_t seq = 1; seq <= 5; ++seq) {
+            packet(frame, payload, seq);
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x00, 0x80), frame, 8, 10 + seq);
+        }
+        REQUIRE(tx.frames.size() == 4);
+        CHECK(tx.frames[0][1] == 2);
+        CHECK(tx.frames[1][1] == 2);
+        CHECK(tx.frames[1][2] == 3);
+        CHECK(tx.frames[2][1] == 1);
+        CHECK(tx.frames[3][0] == CAN_TP_EOMA);
+        REQUIRE(received.size() == 1);
+        CHECK(received[0].data == payload);
+    }
+
+    TEST_CASE("sequence numbers outside the transfer are rejected") {
+        std::vector<Received> received;
+        can_J1939Reassembler<1> tp(CAN_J1939_NULL_ADDR, &collect, &received);
+        const std::vector<uint8_t> payload = pattern(20, 4); // 3 packets
+        const uint8_t grants[2] = {0, 4};
+        for (const uint8_t next : grants) {
+            CAPTURE(next);
+            uint8_t frame[8];
+            control(frame, CAN_TP_RTS, payload.size(), 0xFF, 0xFECA);
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x10, 0x80), frame, 8, 0);
+
+            // A CTS pointing outside the transfer is ignored
+            control(frame, CAN_TP_CTS, 0, 0, 0xFECA);
+            frame[1] = 1;
+            frame[2] = next;
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x80, 0x10), frame, 8, 1);
+            packet(frame, payload, 1);
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x10, 0x80), frame, 8, 2);
+            CHECK(tp.active() == 1);
+
+            // and a packet numbered like it ends the transfer without touching the buffer
+            frame[0] = next;
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x10, 0x80), frame, 8, 3);
+            CHECK(tp.active() == 0);
+            CHECK(received.empty());
+        }
+    }
+
+    TEST_CASE("one source talking to two destinations at once") {
+        std::vector<Received> received;
+        can_J1939Reassembler<4> tp(CAN_J1939_NULL_ADDR, &collect, &received);
+        const std::vector<uint8_t> first = pattern(20, 1), second = pattern(27, 2);
+        uint8_t frame[8];
+        control(frame, CAN_TP_RTS, first.size(), 0xFF, 0xFECA);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x10, 0x80), frame, 8, 0);
+        control(frame, CAN_TP_RTS, second.size(), 0xFF, 0xFEE3);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x10, 0x81), frame, 8, 0);
+        control(frame, CAN_TP_BAM, second.size(), 0xFF, 0xFEEB);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x10), frame, 8, 0);
+        CHECK(tp.active() == 3);
+
+        // The receivers grant all packets; the sender then interleaves the transfers
+        control(frame, CAN_TP_CTS, 0, 0, 0xFECA);
+        frame[1] = 3;
+        frame[2] = 1;
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x80, 0x10), frame, 8, 1);
+        frame[1] = 4;
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x81, 0x10), frame, 8, 1);
+        for (uint8_t seq = 1; seq <= 4; ++seq) {
+            if (seq <= 3) {
+                packet(frame, first, seq);
+                tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x10, 0x80), frame, 8, 1 + seq);
+            }
+            packet(frame, second, seq);
+            tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_DT, 0x10, 0x81), frame, 8, 1 + seq);
+        }
+        REQUIRE(received.size() == 2);
+        CHECK(received[0].destination == 0x80);
+        CHECK(received[0].data == first);
+        CHECK(received[1].destination == 0x81);
+        CHECK(received[1].data == second);
+
+        // The broadcast from the same source is still open; aborting it elsewhere leaves it alone
+        control(frame, CAN_TP_ABORT, 0, 0, 0xFEEB);
+        tp.onFrame(can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, 0x10, 0x80), frame, 8, 10);
+        CHECK(tp.active() == 1);
+    }
+}
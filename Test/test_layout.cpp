@@ -0,0 +1,58 @@
+#include "../can_layout.hpp"
+
+#include "doctest.h"
+
+#include <cstdlib>
+
+TEST_SUITE("Layout compiler") {
+    // Eight status flags, a 4-bit mode and a 12-bit signed value in one Intel run,
+    // then a lone Intel field and two adjacent Motorola fields
+    typedef can_Layout<can_Field<0, 1, true>, can_Field<1, 1, true>, can_Field<2, 1, true>, can_Field<3, 1, true>,
+                       can_Field<4, 1, true>, can_Field<5, 1, true>, can_Field<6, 1, true>, can_Field<7, 1, true>,
+                       can_Field<8, 4, true>, can_Field<12, 12, true, true>,
+                       can_Field<28, 4, true>,
+                       can_Field<56, 10, false, true>, can_Field<50, 6, false>>
+        Status;
+
+    const can_Signal signals[] = {
+        {0, 1, true, false, 1, 0}, {1, 1, true, false, 1, 0}, {2, 1, true, false, 1, 0}, {3, 1, true, false, 1, 0},
+        {4, 1, true, false, 1, 0}, {5, 1, true, false, 1, 0}, {6, 1, true, false, 1, 0}, {7, 1, true, false, 1, 0},
+        {8, 4, true, false, 1, 0}, {12, 12, true, true, 1, 0},
+        {28, 4, true, false, 1, 0},
+        {56, 10, false, true, 1, 0}, {50, 6, false, false, 1, 0},
+    };
+
+    TEST_CASE("adjacent fields merge into runs") {
+        CHECK(Status::size == 13);
+        CHECK(Status::runs == 3);
+        CHECK((can_Layout<can_Field<0, 8, true>, can_Field<8, 8, false>>::runs) == 2);
+    }
+
+    TEST_CASE("bit-exact with the per-signal path") {
+        std::srand(9);
+        for (int frame = 0; frame < 5000; ++frame) {
+            uint8_t buf[8];
+            for (size_t b = 0; b < 8; ++b)
+                buf[b] = static_cast<uint8_t>(std::rand());
+            int64_t raw[Status::size];
+            Status::decode(buf, raw);
+            for (size_t f = 0; f < Status::size; ++f) {
+                if (raw[f] != can_getRawSignal(buf, signals[f]))
+                    FAIL("frame " << frame << " field " << f);
+            }
+        }
+    }
+
+    TEST_CASE("batch columns") {
+        can_Frame frames[16];
+        std::memset(frames, 0, sizeof(frames));
+        for (int i = 0; i < 16; ++i)
+            can_setRawSignal(can_frameData(frames[i]), -i, signals[9]);
+        int64_t columns[Status::size][16];
+        int64_t* const out[Status::size] = {columns[0], columns[1], columns[2], columns[3], columns[4], columns[5], columns[6],
+                                            columns[7], columns[8], columns[9], columns[10], columns[11], columns[12]};
+        Status::decodeBatch(frames, 16, out);
+        for (int i = 0; i < 16; ++i)
+            CHECK(columns[9][i] == -i);
+    }
+}
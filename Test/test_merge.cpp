@@ -0,0 +1,87 @@
+#include "../can_merge.hpp"
+
+#include "doctest.h"
+
+TEST_SUITE("Merge") {
+    TEST_CASE("loser tree merge with reorder window") {
+        for (int k = 1; k <= 5; ++k) {
+            std::vector<std::vector<can_Frame> > buses(k);
+            size_t total = 0;
+            for (int b = 0; b < k; ++b) {
+                for (uint32_t i = 0; i < 500; ++i) {
+                    can_Frame frame;
+                    std::memset(&frame, 0, sizeof(frame));
+                    frame.id = 0x100 + b;
+                    frame.bus = static_cast<uint8_t>(b);
+                    frame.len = 8;
+                    frame.timestamp = i * 100ULL + b * 7;
+                    can_setSignal<uint32_t>(can_frameData(frame), static_cast<uint32_t>(frame.timestamp), 0, 32, true);
+                    buses[b].push_back(frame);
+                }
+                // Swap neighbours so every bus is slightly out of order
+                for (size_t i = 0; i + 1 < buses[b].size(); i += 3)
+                    std::swap(buses[b][i], buses[b][i + 1]);
+                total += buses[b].size();
+            }
+
+            std::vector<can_ArraySource> sources;
+            for (int b = 0; b < k; ++b)
+                sources.push_back(can_ArraySource(buses[b].data(), buses[b].size()));
+            can_MergeStage merge(150, 16);
+            for (int b = 0; b < k; ++b)
+                merge.addSource(&sources[b]);
+
+            can_Frame out[37];
+            uint32_t values[37];
+            uint64_t last = 0;
+            size_t seen = 0;
+            bool ordered = true;
+            size_t n;
+            while ((n = merge.read(out, 37)) > 0) {
+                can_getSignalBatch<uint32_t>(out, n, values, 0, 32, true);
+                for (size_t i = 0; i < n; ++i) {
+                    ordered = ordered && out[i].timestamp >= last && values[i] == out[i].timestamp;
+                    last = out[i].timestamp;
+                }
+                seen += n;
+            }
+            CHECK_MESSAGE(ordered, k);
+            CHECK(seen == total);
+        }
+    }
+
+    TEST_CASE("merging captures, one per bus") {
+        const char* paths[2] = {"Test/test_tmp_merge0.pcap", "Test/test_tmp_merge1.pcapng"};
+        for (int b = 0; b < 2; ++b) {
+            can_PcapWriter writer(paths[b], b ? CAN_PCAPNG : CAN_PCAP);
+            can_Frame frame;
+            std::memset(&frame, 0, sizeof(frame));
+            for (uint32_t i = 0; i < 100; ++i) {
+                frame.timestamp = i * 20ULL + b * 10;
+                writer.write(frame);
+            }
+        }
+
+        can_PcapReader readers[2];
+        REQUIRE(readers[0].open(paths[0]));
+        REQUIRE(readers[1].open(paths[1]));
+        can_PcapSource bus0(readers[0], 0);
+        can_PcapSource bus1(readers[1], 1);
+        can_MergeStage merge;
+        merge.addSource(&bus0);
+        merge.addSource(&bus1);
+
+        can_Frame out[200];
+        REQUIRE(merge.read(out, 200) == 200);
+        for (size_t i = 0; i < 200; ++i) {
+            CHECK(out[i].timestamp == i * 10);
+            CHECK(out[i].bus == i % 2);
+        }
+        CHECK(merge.read(out, 200) == 0);
+
+        for (int b = 0; b < 2; ++b) {
+            readers[b].close();
+            std::remove(paths[b]);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include "../can_obd.hpp"
+
+#include "doctest.h"
+
+TEST_SUITE("OBD-II") {
+    TEST_CASE("single PID formulas") {
+        const can_ObdDecoder obd;
+        uint8_t pids[6];
+        float values[6];
+
+        const uint8_t rpm[] = {0x41, 0x0C, 0x1A, 0xF8}; // (256 * 0x1A + 0xF8) / 4
+        REQUIRE(obd.decodeResponse(rpm, sizeof(rpm), pids, values, 6) == 1);
+        CHECK(pids[0] == 0x0C);
+        CHECK(values[0] == doctest::Approx(1726.0f));
+
+        const uint8_t coolant[] = {0x41, 0x05, 0x7B};
+        REQUIRE(obd.decodeResponse(coolant, sizeof(coolant), pids, values, 6) == 1);
+        CHECK(values[0] == doctest::Approx(83.0f));
+
+        const uint8_t trim[] = {0x41, 0x06, 0x70};
+        REQUIRE(obd.decodeResponse(trim, sizeof(trim), pids, values, 6) == 1);
+        CHECK(values[0] == doctest::Approx(-12.5f));
+
+        const uint8_t voltage[] = {0x41, 0x42, 0x37, 0x6E}; // 14190 mV
+        REQUIRE(obd.decodeResponse(voltage, sizeof(voltage), pids, values, 6) == 1);
+        CHECK(values[0] == doctest::Approx(14.19f));
+    }
+
+    TEST_CASE("multi-PID response in one pass") {
+        const can_ObdDecoder obd;
+        // Speed, supported PIDs (no value), MAF, throttle
+        const uint8_t response[] = {0x41, 0x0D, 0x32, 0x00, 0xBE, 0x3E, 0xB8, 0x13, 0x10, 0x01, 0xF4, 0x11, 0x80};
+        uint8_t pids[6];
+        float values[6];
+        REQUIRE(obd.decodeResponse(response, sizeof(response), pids, values, 6) == 3);
+        CHECK(pids[0] == 0x0D);
+        CHECK(values[0] == doctest::Approx(50.0f));
+        CHECK(pids[1] == 0x10);
+        CHECK(values[1] == doctest::Approx(5.0f));
+        CHECK(pids[2] == 0x11);
+        CHECK(values[2] == doctest::Approx(128.0f * 100.0f / 255.0f));
+        // The walk stops once the output arrays are full
+        CHECK(obd.decodeResponse(response, sizeof(response), pids, values, 2) == 2);
+        CHECK(pids[1] == 0x10);
+
+        // Truncated entries and unknown PIDs end the walk
+        CHECK(obd.decodeResponse(response, 10, pids, values, 6) == 1);
+        const uint8_t unknown[] = {0x41, 0x0D, 0x32, 0xA6, 0x00, 0x11, 0x80};
+        CHECK(obd.decodeResponse(unknown, sizeof(unknown), pids, values, 6) == 1);
+        const uint8_t negative[] = {0x7F, 0x01, 0x12};
+        CHECK(obd.decodeResponse(negative, sizeof(negative), pids, values, 6) == 0);
+    }
+
+    TEST_CASE("custom PIDs") {
+        const can_ObdPid odometer[] = {{0xA6, 4, {24, 32, false, false, 0.1f, 0.0f}}};
+        can_ObdDecoder obd;
+        CHECK(obd.find(0xA6) == nullptr);
+        obd.add(odometer, 1);
+        REQUIRE(obd.find(0xA6) != nullptr);
+        const uint8_t response[] = {0x41, 0xA6, 0x00, 0x01, 0xE2, 0x40};
+        uint8_t pid;
+        float value;
+        REQUIRE(obd.decodeResponse(response, sizeof(response), &pid, &value, 1) == 1);
+        CHECK(value == doctest::Approx(12345.6f));
+    }
+
+    TEST_CASE("batch decode of logged responses") {
+        const can_ObdDecoder obd;
+        can_Frame frames[4] = {};
+        const uint8_t payloads[4][8] = {
+            {0x04, 0x41, 0x0C, 0x0F, 0xA0, 0xAA, 0xAA, 0xAA}, // 1000 rpm
+            {0x02, 0x01, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00}, // request, skipped
+            {0x06, 0x41, 0x0D, 0x28, 0x0C, 0x1F, 0x40, 0xAA}, // speed and 2000 rpm
+            {0x10, 0x0A, 0x41, 0x0C, 0x2E, 0xE0, 0x0D, 0x28}, // first frame, skipped
+        };
+        for (size_t i = 0; i < 4; ++i) {
+            frames[i].timestamp = 100 * i;
+            frames[i].id = i == 1 ? 0x7DF : 0x7E8;
+            frames[i].len = 8;
+            std::memcpy(frames[i].data, payloads[i], 8);
+        }
+        float rpm[4];
+        uint64_t timestamps[4];
+        REQUIRE(obd.decodeBatch(frames, 4, 0x0C, rpm, timestamps) == 2);
+        CHECK(rpm[0] == doctest::Approx(1000.0f));
+        CHECK(rpm[1] == doctest::Approx(2000.0f));
+        CHECK(timestamps[0] == 0);
+        CHECK(timestamps[1] == 200);
+        CHECK(obd.decodeBatch(frames, 4, 0x00, rpm, nullptr) == 0);
+    }
+}
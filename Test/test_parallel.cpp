@@ -0,0 +1,106 @@
+#include "../can_parallel.hpp"
+
+#include "doctest.h"
+
+#include <cstdio>
+
+TEST_SUITE("Parallel decode") {
+    TEST_CASE("work-stealing pool runs nested tasks") {
+        std::atomic<int> count(0);
+        can_WorkStealingPool pool(4);
+        for (int i = 0; i < 100; ++i) {
+            pool.submit([&](unsigned worker) {
+                for (int j = 0; j < 10; ++j)
+                    pool.submit([&](unsigned) { ++count; }, worker);
+                ++count;
+            });
+        }
+        pool.wait();
+        CHECK(count == 1100);
+    }
+
+    TEST_CASE("multi-file decode in timestamp order") {
+        const can_SignalRequest requests[2] = {
+            {0x100, false, {0, 32, true, false, 1.0f, 0.0f}},
+            {0x18FEF100, true, {40, 16, true, true, 0.5f, 0.0f}},
+        };
+        std::vector<can_SignalRequest> req(requests, requests + 2);
+
+        std::vector<std::string> files;
+        size_t expected100 = 0;
+        for (int f = 0; f < 6; ++f) {
+            char path[64];
+            std::snprintf(path, sizeof(path), "Test/test_tmp_par%d.%s", f, f % 2 ? "pcap" : "pcapng");
+            files.push_back(path);
+            can_PcapWriter writer(path, f % 2 ? CAN_PCAP : CAN_PCAPNG);
+            can_Frame frame;
+            std::memset(&frame, 0, sizeof(frame));
+            frame.len = 8;
+            for (uint32_t i = 0; i < 3000; ++i) {
+                // Files overlap in time, so the result has to interleave them
+                frame.timestamp = i * 60ULL + f * 10;
+                frame.id = (i % 3 == 0) ? 0x18FEF100 : 0x100;
+                frame.flags = (i % 3 == 0) ? CAN_FRAME_EXTENDED : 0;
+                if (frame.id == 0x100)
+                    ++expected100;
+                can_setSignal<uint32_t>(can_frameData(frame), static_cast<uint32_t>(frame.timestamp), 0, 32, true);
+                can_setSignal<int16_t>(can_frameData(frame), static_cast<int16_t>(-static_cast<int>(i)), 40, 16, true);
+                writer.write(frame);
+            }
+        }
+
+        std::vector<can_SignalColumn> columns;
+        REQUIRE(can_decodeParallel(files, req, columns, 4, 8192));
+        REQUIRE(columns.size() == 2);
+        REQUIRE(columns[0].timestamps.size() == expected100);
+        REQUIRE(columns[1].timestamps.size() == 6 * 1000);
+        for (size_t i = 1; i < columns[0].timestamps.size(); ++i)
+            CHECK_MESSAGE(columns[0].timestamps[i] > columns[0].timestamps[i - 1], i);
+        for (size_t i = 0; i < columns[0].timestamps.size(); ++i)
+            CHECK_MESSAGE(columns[0].values[i] == static_cast<float>(columns[0].timestamps[i]), i);
+        CHECK(columns[1].values[0] == 0.0f);
+        CHECK(columns[1].values.back() == -2997 * 0.5f);
+
+        for (size_t f = 0; f < files.size(); ++f)
+            std::remove(files[f].c_str());
+    }
+
+    TEST_CASE("FD frames on a bus declared mid-file") {
+        const can_SignalRequest requests[2] = {
+            {0x100, false, {0, 32, true, false, 1.0f, 0.0f}},
+            {0x200, false, {96, 32, true, false, 1.0f, 0.0f}}, // bytes 12-15 of an FD payload
+        };
+        std::vector<can_SignalRequest> req(requests, requests + 2);
+        std::vector<std::string> files(1, "Test/test_tmp_par_fd.pcapng");
+        {
+            can_PcapWriter writer(files[0].c_str(), CAN_PCAPNG);
+            can_Frame frame;
+            for (uint32_t i = 0; i < 4000; ++i) {
+                std::memset(&frame, 0, sizeof(frame));
+                frame.timestamp = i * 10ULL;
+                // Bus 1 and its interface description only appear after the first 1000 frames
+                if (i >= 1000 && i % 2) {
+                    frame.bus = 1;
+                    frame.id = 0x200;
+                    frame.flags = CAN_FRAME_FD;
+                    frame.len = 16;
+                    std::memcpy(frame.data + 12, &i, 4);
+                } else {
+                    frame.id = 0x100;
+                    frame.len = 8;
+                    can_setSignal<uint32_t>(can_frameData(frame), i, 0, 32, true);
+                }
+                writer.write(frame);
+            }
+        }
+
+        std::vector<can_SignalColumn> columns;
+        REQUIRE(can_decodeParallel(files, req, columns, 4, 4096));
+        REQUIRE(columns[0].timestamps.size() == 2500);
+        REQUIRE(columns[1].timestamps.size() == 1500);
+        for (size_t i = 0; i < columns[1].values.size(); ++i)
+            CHECK_MESSAGE(columns[1].values[i] == static_cast<float>(columns[1].timestamps[i] / 10), i);
+
+        std::remove(files[0].c_str());
+    }
+}
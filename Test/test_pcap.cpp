@@ -0,0 +1,157 @@
+#include "../can_pcap.hpp"
+
+#include "doctest.h"
+
+static can_Frame makeFrame(uint64_t timestamp, uint32_t id, uint8_t len, uint8_t flags, uint8_t bus) {
+    can_Frame frame;
+    std::memset(&frame, 0, sizeof(frame));
+    frame.timestamp = timestamp;
+    frame.id = id;
+    frame.len = len;
+    frame.flags = flags;
+    frame.bus = bus;
+    for (uint8_t i = 0; i < len; ++i)
+        frame.data[i] = static_cast<uint8_t>(i + id);
+    return frame;
+}
+
+TEST_SUITE("PCAP") {
+    TEST_CASE("PCAPNG round trip") {
+        const char* path = "Test/test_tmp.pcapng";
+        can_Frame frames[3] = {
+            makeFrame(1000001, 0x123, 8, 0, 0),
+            makeFrame(1000250, 0x18FEF100, 64, CAN_FRAME_EXTENDED | CAN_FRAME_FD | CAN_FRAME_BRS, 1),
+            makeFrame(5000000000ULL, 0x7FF, 3, 0, 0),
+        };
+        can_setSignal<uint16_t>(can_frameData(frames[0]), 0x0BB8, 24, 16, false);
+
+        {
+            can_PcapWriter writer(path, CAN_PCAPNG, 2);
+            REQUIRE(writer.isOpen());
+            CHECK(writer.write(frames, 3));
+        }
+
+        can_PcapReader reader;
+        REQUIRE(reader.open(path));
+        can_Frame batch[8];
+        REQUIRE(reader.readBatch(batch, 8) == 3);
+        CHECK(reader.readBatch(batch + 3, 5) == 0);
+
+        for (int i = 0; i < 3; ++i) {
+            CHECK(batch[i].timestamp == frames[i].timestamp);
+            CHECK(batch[i].id == frames[i].id);
+            CHECK(batch[i].len == frames[i].len);
+            CHECK(batch[i].flags == frames[i].flags);
+            CHECK(batch[i].bus == frames[i].bus);
+            CHECK(std::memcmp(batch[i].data, frames[i].data, 64) == 0);
+        }
+
+        float speed[1];
+        can_getSignalBatch<uint16_t>(batch, 1, speed, 24, 16, false, 0.1f, 0.0f);
+        CHECK(speed[0] == 300.0f);
+
+        reader.rewind();
+        can_Frame frame;
+        REQUIRE(reader.next(frame));
+        const size_t second = reader.offset();
+        REQUIRE(reader.next(frame));
+        CHECK(frame.id == 0x18FEF100);
+        REQUIRE(reader.seek(second));
+        REQUIRE(reader.next(frame));
+        CHECK(frame.id == 0x18FEF100);
+
+        reader.close();
+        std::remove(path);
+    }
+
+    TEST_CASE("PCAP round trip") {
+        const char* path = "Test/test_tmp.pcap";
+        can_Frame frames[2] = {
+            makeFrame(42, 0x100, 2, CAN_FRAME_RTR, 0),
+            makeFrame(3000000123ULL, 0x1ABCDEF, 12, CAN_FRAME_EXTENDED | CAN_FRAME_FD, 0),
+        };
+        {
+            can_PcapWriter writer(path, CAN_PCAP);
+            CHECK(writer.write(frames, 2));
+        }
+
+        can_PcapReader reader;
+        REQUIRE(reader.open(path));
+        can_Frame frame;
+        for (int i = 0; i < 2; ++i) {
+            REQUIRE(reader.next(frame));
+            CHECK(frame.timestamp == frames[i].timestamp);
+            CHECK(frame.id == frames[i].id);
+            CHECK(frame.len == frames[i].len);
+            CHECK(frame.flags == frames[i].flags);
+        }
+        CHECK_FALSE(reader.next(frame));
+
+        reader.close();
+        std::remove(path);
+    }
+
+    TEST_CASE("PCAPNG big-endian section with nanosecond resolution") {
+        // SHB, IDB with if_tsresol = 9, one EPB holding a classic frame
+        const uint8_t capture[] = {
+            0x0A, 0x0D, 0x0D, 0x0A, 0x00, 0x00, 0x00, 0x1C, 0x1A, 0x2B, 0x3C, 0x4D,
+            0x00, 0x01, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0x00, 0x00, 0x00, 0x1C,
+            0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x20, 0x00, 0xE3, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x10, 0x00, 0x09, 0x00, 0x01, 0x09, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20,
+            0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x3B, 0x9A, 0xCA, 0x00, 0x00, 0x00, 0x00, 0x10,
+            0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x02, 0x34, 0x02, 0x00, 0x00, 0x00,
+            0xAA, 0x55, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30,
+        };
+        const char* path = "Test/test_tmp_be.pcapng";
+        std::FILE* f = std::fopen(path, "wb");
+        REQUIRE(f);
+        std::fwrite(capture, 1, sizeof(capture), f);
+        std::fclose(f);
+
+        can_PcapReader reader;
+        REQUIRE(reader.open(path));
+        can_Frame frame;
+        REQUIRE(reader.next(frame));
+        CHECK(frame.timestamp == 1000000);
+        CHECK(frame.id == 0x234);
+        CHECK(frame.len == 2);
+        CHECK(frame.flags == 0);
+        CHECK(can_getSignal<uint16_t>(can_frameData(frame), 0, 16, true) == 0x55AA);
+        CHECK_FALSE(reader.next(frame));
+        reader.close();
+
+        // 2^-48 s resolution and an error frame: 1.5 s, with every error class bit kept
+        uint8_t patched[sizeof(capture)];
+        std::memcpy(patched, capture, sizeof(capture));
+        patched[48] = 0x80 | 48;
+        const uint8_t ts[8] = {0x00, 0x01, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00};
+        std::memcpy(patched + 72, ts, sizeof(ts));
+        const uint8_t errorId[4] = {0x20, 0x00, 0x0A, 0x40};
+        std::memcpy(patched + 88, errorId, sizeof(errorId));
+        f = std::fopen(path, "wb");
+        REQUIRE(f);
+        std::fwrite(patched, 1, sizeof(patched), f);
+        std::fclose(f);
+        REQUIRE(reader.open(path));
+        REQUIRE(reader.next(frame));
+        CHECK(frame.timestamp == 1500000);
+        CHECK(frame.id == 0xA40);
+        CHECK(frame.flags == CAN_FRAME_ERROR);
+        reader.close();
+
+        // A resolution of 2^-64 s cannot be converted, so the interface's packets are skipped
+        patched[48] = 0x80 | 64;
+        f = std::fopen(path, "wb");
+        REQUIRE(f);
+        std::fwrite(patched, 1, sizeof(patched), f);
+        std::fclose(f);
+        REQUIRE(reader.open(path));
+        CHECK_FALSE(reader.next(frame));
+
+        reader.close();
+        std::remove(path);
+    }
+}
@@ -0,0 +1,215 @@
+#include "../can_scheduler.hpp"
+
+#include "doctest.h"
+
+#include <cstdlib>
+#include <vector>
+
+#ifdef __linux__
+#include "../can_socketcan.hpp"
+#endif
+
+namespace {
+struct FiredLog {
+    std::vector<uint64_t> expiries;
+    std::vector<uint64_t> times;
+};
+
+void recordFired(void* context, can_Timer& timer, const uint64_t now) {
+    FiredLog& log = *static_cast<FiredLog*>(context);
+    log.expiries.push_back(timer.expiry);
+    log.times.push_back(now);
+}
+
+struct Periodic {
+    can_TimerWheel<>* wheel;
+    uint64_t period;
+    int count;
+};
+
+void rearm(void* context, can_Timer& timer, const uint64_t) {
+    Periodic& p = *static_cast<Periodic*>(context);
+    ++p.count;
+    p.wheel->schedule(timer, timer.expiry + p.period);
+}
+
+struct Sent {
+    uint32_t id;
+    uint64_t time;
+    uint8_t first;
+};
+
+struct Bus {
+    const uint64_t* clock;
+    std::vector<Sent> sent;
+};
+
+bool recordTx(void* context, const uint32_t id, const bool, const uint8_t (&data)[8], const uint8_t) {
+    Bus& bus = *static_cast<Bus*>(context);
+    const Sent s = {id, *bus.clock, data[0]};
+    bus.sent.push_back(s);
+    return true;
+}
+} // namespace
+
+TEST_SUITE("Timing wheel") {
+    TEST_CASE("timers fire exactly at their expiry") {
+        std::srand(11);
+        can_TimerWheel<> wheel;
+        FiredLog log;
+        std::vector<can_Timer> timers(2000);
+        for (size_t i = 0; i < timers.size(); ++i) {
+            can_initTimer(timers[i], &recordFired, &log);
+            // Mix short, multi-level and beyond-range (> 2^24) delays
+            const uint64_t delay = (i % 10 == 0) ? (1ULL << 24) + std::rand() % 5000 : std::rand() % 300000;
+            wheel.schedule(timers[i], delay);
+        }
+        for (size_t i = 0; i < timers.size(); i += 7)
+            wheel.cancel(timers[i]);
+        const size_t expected = wheel.size();
+
+        size_t fired = 0;
+        for (uint64_t now = 0; now < (1ULL << 24) + 6000; now += 1 + std::rand() % 3000)
+            fired += wheel.advance(now);
+        fired += wheel.advance((1ULL << 24) + 6000);
+
+        CHECK(fired == expected);
+        CHECK(wheel.size() == 0);
+        size_t wrong = 0;
+        for (size_t i = 0; i < log.expiries.size(); ++i) {
+            if (log.times[i] != log.expiries[i] || (i > 0 && log.expiries[i] < log.expiries[i - 1]))
+                ++wrong;
+        }
+        CHECK(wrong == 0);
+        for (size_t i = 0; i < timers.size(); i += 7)
+            CHECK_FALSE(can_TimerWheel<>::pending(timers[i]));
+    }
+
+    TEST_CASE("callbacks rearm and long jumps catch up") {
+        can_TimerWheel<> wheel(100);
+        Periodic p = {&wheel, 10, 0};
+        can_Timer timer;
+        can_initTimer(timer, &rearm, &p);
+        wheel.schedule(timer, 105);
+
+        CHECK(wheel.advance(104) == 0);
+        CHECK(wheel.advance(105) == 1);
+        CHECK(timer.expiry == 115);
+        CHECK(wheel.advance(1104) == 99);
+        CHECK(p.count == 100);
+
+        wheel.cancel(timer);
+        CHECK(wheel.size() == 0);
+        CHECK(wheel.advance(5000) == 0);
+    }
+    TEST_CASE("rescheduling a pending timer keeps the count") {
+        can_TimerWheel<> wheel;
+        FiredLog log;
+        can_Timer timer;
+        can_initTimer(timer, &recordFired, &log);
+        for (uint64_t i = 0; i < 1000; ++i)
+            wheel.schedule(timer, 50 + i);
+        CHECK(wheel.size() == 1);
+        wheel.cancel(timer);
+        CHECK(wheel.size() == 0);
+        CHECK(wheel.advance(5000) == 0);
+        CHECK(log.times.empty());
+    }
+}
+
+TEST_SUITE("TX scheduler") {
+    TEST_CASE("cyclic messages with staggered offsets") {
+        uint64_t clock = 0;
+        Bus bus = {&clock, std::vector<Sent>()};
+        can_TxScheduler<8> sched(&recordTx, &bus);
+        for (uint32_t i = 0; i < 4; ++i) {
+            const can_TxMessage msg = {0x100 + i, false, 8, CAN_TX_CYCLIC, 10, 0, 0};
+            CHECK(sched.add(msg) == static_cast<int>(i));
+        }
+        const can_TxMessage slow = {0x200, false, 8, CAN_TX_CYCLIC, 100, 0, 0};
+        sched.add(slow);
+        sched.stagger();
+        sched.start(0);
+
+        for (clock = 0; clock < 100; ++clock)
+            sched.advance(clock);
+
+        CHECK(bus.sent.size() == 4 * 10 + 1);
+        std::vector<uint64_t> perTick(100, 0);
+        for (size_t i = 0; i < bus.sent.size(); ++i)
+            ++perTick[bus.sent[i].time];
+        size_t busiest = 0;
+        for (size_t t = 0; t < perTick.size(); ++t)
+            busiest = perTick[t] > busiest ? perTick[t] : busiest;
+        CHECK(busiest <= 2); // the four 10 ms messages land on 0, 2, 5, 7
+
+        for (size_t i = 0; i < bus.sent.size(); ++i) {
+            if (bus.sent[i].id == 0x102)
+                CHECK(bus.sent[i].time % 10 == 5);
+        }
+    }
+
+    TEST_CASE("on-change and mixed modes") {
+        uint64_t clock = 0;
+        Bus bus = {&clock, std::vector<Sent>()};
+        can_TxScheduler<2> sched(&recordTx, &bus);
+        const can_TxMessage event = {0x300, false, 8, CAN_TX_ON_CHANGE, 0, 0, 20};
+        const can_TxMessage mixed = {0x301, false, 8, CAN_TX_MIXED, 50, 0, 0};
+        const int e = sched.add(event);
+        const int m = sched.add(mixed);
+        sched.start(0);
+
+        for (clock = 0; clock <= 100; ++clock) {
+            sched.advance(clock);
+            if (clock == 3) {
+                sched.setSignal<uint8_t>(e, 1, 0, 8, true); // sent now
+                sched.setSignal<uint8_t>(e, 1, 0, 8, true); // unchanged, not sent
+            }
+            if (clock == 10)
+                sched.setSignal<uint8_t>(e, 2, 0, 8, true); // deferred to 23
+            if (clock == 15)
+                sched.setSignal<uint8_t>(e, 3, 0, 8, true); // merged into the deferred send
+            if (clock == 30)
+                sched.setSignal<uint8_t>(m, 9, 0, 8, true);
+        }
+
+        std::vector<Sent> events, cyclic;
+        for (size_t i = 0; i < bus.sent.size(); ++i)
+            (bus.sent[i].id == 0x300 ? events : cyclic).push_back(bus.sent[i]);
+
+        REQUIRE(events.size() == 2);
+        CHECK(events[0].time == 3);
+        CHECK(events[0].first == 1);
+        CHECK(events[1].time == 23);
+        CHECK(events[1].first == 3);
+
+        REQUIRE(cyclic.size() == 4);
+        CHECK(cyclic[0].time == 0);
+        CHECK(cyclic[1].time == 30);
+        CHECK(cyclic[1].first == 9);
+        CHECK(cyclic[2].time == 50);
+        CHECK(cyclic[3].time == 100);
+    }
+
+#ifdef __linux__
+    TEST_CASE("transmit on vcan0") {
+        // Needs: ip link add dev vcan0 type vcan && ip link set up vcan0
+        can_SocketCan tx, rx;
+        if (!tx.open("vcan0") || !rx.open("vcan0"))
+            return;
+
+        can_TxScheduler<1> sched(&can_SocketCan::transmit, &tx);
+        const can_TxMessage msg = {0x18FEF100, true, 8, CAN_TX_CYCLIC, 10, 0, 0};
+        sched.add(msg);
+        sched.setSignal<uint16_t>(0, 0x1234, 8, 16, true);
+        sched.start(0);
+        sched.advance(0);
+
+        can_Frame frame;
+        REQUIRE(rx.receive(frame));
+        CHECK(frame.id == 0x18FEF100);
+        CHECK((frame.flags & CAN_FRAME_EXTENDED) != 0);
+        CHECK(can_getSignal<uint16_t>(can_frameData(frame), 8, 16, true) == 0x1234);
+    }
+#endif
+}
@@ -0,0 +1,63 @@
+#include "../can_staging.hpp"
+
+#include "doctest.h"
+
+#include <cstdlib>
+
+TEST_SUITE("Message staging") {
+    const can_Signal signals[] = {
+        {0, 12, true, false, 0.25f, 0.0f},    // Intel, unsigned
+        {12, 4, true, false, 1.0f, 0.0f},     // Intel, shares a byte with the first
+        {16, 10, true, true, 0.1f, -5.0f},    // Intel, signed
+        {56, 16, false, false, 0.125f, 0.0f}, // Motorola
+        {44, 6, false, true, 2.0f, 0.0f},     // Motorola, signed, straddles bytes 4 and 5
+    };
+    const size_t SIGNALS = sizeof(signals) / sizeof(signals[0]);
+
+    TEST_CASE("packing is bit-exact with per-signal setSignal") {
+        std::srand(3);
+        can_MessageStage<8> stage(signals, SIGNALS);
+        CHECK(stage.size() == SIGNALS);
+        uint8_t reference[8] = {0};
+
+        for (int cycle = 0; cycle < 2000; ++cycle) {
+            for (size_t i = 0; i < SIGNALS; ++i) {
+                if (std::rand() % 3 != 0)
+                    continue; // most values stay put between cycles
+                const int64_t raw = std::rand() % (1 << signals[i].length) - (signals[i].isSigned ? (1 << (signals[i].length - 1)) : 0);
+                const float value = raw * signals[i].factor + signals[i].offset;
+                stage.set(i, value);
+                can_setSignal(reference, value, signals[i]);
+            }
+            stage.pack();
+            if (std::memcmp(stage.data(), reference, 8) != 0)
+                FAIL("cycle " << cycle);
+        }
+    }
+
+    TEST_CASE("unchanged values do not mark the frame") {
+        can_MessageStage<8> stage(signals, SIGNALS);
+        stage.set(3, 1500.0f);
+        CHECK(stage.dirty());
+        CHECK(stage.pack());
+        CHECK(stage.changed());
+        stage.markSent();
+
+        stage.set(3, 1500.0f); // same value
+        CHECK_FALSE(stage.dirty());
+        CHECK_FALSE(stage.pack());
+        CHECK_FALSE(stage.changed());
+
+        stage.setRaw(4, -1);
+        stage.setRaw(4, 0); // back to what was packed
+        CHECK(stage.dirty());
+        CHECK_FALSE(stage.pack());
+        CHECK_FALSE(stage.changed());
+
+        stage.setRaw(1, 0x1F); // only the low four bits fit
+        CHECK(stage.pack());
+        CHECK(can_getRawSignal(stage.data(), signals[1]) == 0xF);
+        CHECK(can_getSignal(stage.data(), signals[3]) == 1500.0f);
+        CHECK(stage.changed());
+    }
+}
@@ -0,0 +1,83 @@
+#include "../can_store.hpp"
+
+#include "doctest.h"
+
+#include <thread>
+
+TEST_SUITE("Latest-value store") {
+    TEST_CASE("entries are cache-line sized") {
+        CHECK(sizeof(can_StoreEntry) == CAN_CACHE_LINE);
+        CHECK(alignof(can_StoreEntry) == CAN_CACHE_LINE);
+    }
+
+    TEST_CASE("read back latest frame") {
+        can_LatestStore<4> store;
+        uint8_t buf[8] = {0};
+        CHECK_FALSE(store.read(2, buf));
+
+        can_setSignal<uint16_t>(buf, 0x0BB8, 24, 16, false);
+        store.write(2, buf, 0x123456789AULL);
+        can_setSignal<uint16_t>(buf, 0x0FA0, 24, 16, false);
+        store.write(2, buf, 0x123456789BULL);
+
+        uint8_t out[8];
+        uint64_t ts = 0;
+        CHECK(store.read(2, out, &ts));
+        CHECK(ts == 0x123456789BULL);
+        CHECK(store.getSignal<uint16_t>(2, 24, 16, false) == 0x0FA0);
+        const can_Signal sig = {24, 16, false, false, 0.1f, 0.0f};
+        CHECK(store.getSignal(2, sig) == 400.0f);
+    }
+
+    TEST_CASE("indices outside the store") {
+        can_LatestStore<2> store;
+        uint8_t buf[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+        store.write(2, buf, 10);
+        store.invalidate(2);
+        CHECK_FALSE(store.valid(2));
+        CHECK_FALSE(store.read(2, buf));
+        CHECK(buf[0] == 1);
+        float value = 5.0f;
+        const can_Signal sig = {0, 8, true, false, 1.0f, 0.0f};
+        CHECK_FALSE(store.getSignal(2, sig, value));
+        CHECK(value == 5.0f);
+        CHECK(store.getSignal(2, sig) == 0.0f);
+    }
+
+    TEST_CASE("readers never see torn frames") {
+        can_LatestStore<2> store;
+        std::atomic<bool> done(false);
+        std::atomic<bool> torn(false);
+
+        std::thread writer([&]() {
+            uint8_t buf[8];
+            for (uint32_t i = 1; i <= 200000; ++i) {
+                // Both halves and the timestamp carry the same counter
+                std::memcpy(buf, &i, 4);
+                std::memcpy(buf + 4, &i, 4);
+                store.write(i & 1, buf, i);
+            }
+            done = true;
+        });
+
+        std::thread reader([&]() {
+            uint8_t buf[8];
+            uint64_t ts;
+            while (!done) {
+                for (size_t e = 0; e < 2; ++e) {
+                    if (!store.read(e, buf, &ts))
+                        continue;
+                    uint32_t lo, hi;
+                    std::memcpy(&lo, buf, 4);
+                    std::memcpy(&hi, buf + 4, 4);
+                    if (lo != hi || lo != ts || (lo & 1) != e)
+                        torn = true;
+                }
+            }
+        });
+
+        writer.join();
+        reader.join();
+        CHECK_FALSE(torn);
+    }
+}
@@ -0,0 +1,73 @@
+#include "../can_subscribe.hpp"
+
+#include "doctest.h"
+
+#include <vector>
+
+namespace {
+struct Notification {
+    uint16_t startBit;
+    float value;
+    uint64_t timestamp;
+};
+
+void record(void* context, const can_Signal& signal, float value, uint64_t timestamp) {
+    Notification n = {signal.startBit, value, timestamp};
+    static_cast<std::vector<Notification>*>(context)->push_back(n);
+}
+} // namespace
+
+TEST_SUITE("Subscriptions") {
+    TEST_CASE("signal masks") {
+        CHECK(can_signalMask(4, 8, true) == 0xFF0ULL);
+        // Motorola 16 bit signal with start bit 24 occupies bytes 2 and 3
+        CHECK(can_signalMask(24, 16, false) == 0xFFFF0000ULL);
+        CHECK(can_signalMask(0, 64, true) == -1ULL);
+    }
+
+    TEST_CASE("only changed signals notify") {
+        can_SubscriptionEngine<2, 4> engine;
+        std::vector<Notification> log;
+        const can_Signal speed = {24, 16, false, false, 0.1f, 0.0f};
+        const can_Signal gear = {0, 4, true, false, 1.0f, 0.0f};
+        REQUIRE(engine.subscribe(1, speed, record, &log) == 0);
+        REQUIRE(engine.subscribe(1, gear, record, &log) == 1);
+
+        uint8_t buf[8] = {0};
+        can_setSignal<uint16_t>(buf, 3000, 24, 16, false);
+        can_setSignal<uint8_t>(buf, 3, 0, 4, true);
+        CHECK(engine.onFrame(1, buf, 10) == 2);
+
+        // Identical frame and a change in unsubscribed bits are both skipped
+        CHECK(engine.onFrame(1, buf, 20) == 0);
+        buf[7] = 0xAA;
+        can_setSignal<uint8_t>(buf, 0xF, 4, 4, true);
+        CHECK(engine.onFrame(1, buf, 30) == 0);
+
+        can_setSignal<uint16_t>(buf, 3001, 24, 16, false);
+        CHECK(engine.onFrame(1, buf, 40) == 1);
+        REQUIRE(log.size() == 3);
+        CHECK(log[2].startBit == 24);
+        CHECK(log[2].value == doctest::Approx(300.1f));
+        CHECK(log[2].timestamp == 40);
+
+        // Other messages keep their own history
+        CHECK(engine.onFrame(0, buf, 50) == 0);
+        engine.reset(1);
+        CHECK(engine.onFrame(1, buf, 60) == 2);
+    }
+
+    TEST_CASE("messages outside the table are ignored") {
+        can_SubscriptionEngine<2, 4> engine;
+        std::vector<Notification> log;
+        const can_Signal gear = {0, 4, true, false, 1.0f, 0.0f};
+        CHECK(engine.subscribe(2, gear, record, &log) == -1);
+        REQUIRE(engine.subscribe(1, gear, record, &log) == 0);
+
+        uint8_t buf[8] = {3};
+        CHECK(engine.onFrame(2, buf, 10) == 0);
+        engine.reset(2);
+        CHECK(log.empty());
+        CHECK(engine.onFrame(1, buf, 20) == 1);
+    }
+}
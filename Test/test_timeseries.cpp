@@ -0,0 +1,188 @@
+#include "../can_timeseries.hpp"
+
+#include "doctest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+static float naiveAsof(const can_SignalColumn& c, const uint64_t t, const can_Interpolation mode, const float missing) {
+    int last = -1;
+    for (size_t i = 0; i < c.timestamps.size(); ++i) {
+        if (c.timestamps[i] <= t)
+            last = static_cast<int>(i);
+    }
+    if (last < 0)
+        return missing;
+    if (mode == CAN_HOLD || last + 1 == static_cast<int>(c.timestamps.size()))
+        return c.values[last];
+    const float frac = static_cast<float>(t - c.timestamps[last]) / static_cast<float>(c.timestamps[last + 1] - c.timestamps[last]);
+    return c.values[last] + (c.values[last + 1] - c.values[last]) * frac;
+}
+
+TEST_SUITE("Time series") {
+    TEST_CASE("hold and linear resampling") {
+        can_SignalColumn c;
+        const uint64_t ts[] = {1000, 3000, 4000, 10000};
+        const float vs[] = {1.0f, 3.0f, -1.0f, 5.0f};
+        c.timestamps.assign(ts, ts + 4);
+        c.values.assign(vs, vs + 4);
+
+        float hold[12], linear[12];
+        can_resample(ts, vs, 4, 0, 1000, 12, hold, CAN_HOLD, -99.0f);
+        can_resample(ts, vs, 4, 0, 1000, 12, linear, CAN_LINEAR, -99.0f);
+        const float expectHold[12] = {-99, 1, 1, 3, -1, -1, -1, -1, -1, -1, 5, 5};
+        const float expectLinear[12] = {-99, 1, 2, 3, -1, 0, 1, 2, 3, 4, 5, 5};
+        for (int i = 0; i < 12; ++i) {
+            CHECK(hold[i] == expectHold[i]);
+            CHECK(linear[i] == doctest::Approx(expectLinear[i]));
+        }
+    }
+
+    TEST_CASE("matches a naive as-of join") {
+        std::srand(7);
+        can_SignalColumn columns[3];
+        for (int c = 0; c < 3; ++c) {
+            uint64_t t = 500 * c;
+            for (int i = 0; i < 2000; ++i) {
+                t += 1 + std::rand() % (1000 * (c + 1));
+                columns[c].timestamps.push_back(t);
+                columns[c].values.push_back(static_cast<float>(std::rand() % 1000));
+            }
+        }
+
+        const size_t points = 3000;
+        std::vector<float> aligned[3];
+        for (int mode = 0; mode < 2; ++mode) {
+            const can_Interpolation interp = mode ? CAN_LINEAR : CAN_HOLD;
+            can_alignColumns(columns, 3, 0, 1000, points, aligned, interp, -1.0f);
+            bool same = true;
+            for (int c = 0; c < 3; ++c) {
+                REQUIRE(aligned[c].size() == points);
+                for (size_t i = 0; i < points; ++i)
+                    same = same && aligned[c][i] == doctest::Approx(naiveAsof(columns[c], i * 1000, interp, -1.0f));
+            }
+            CHECK_MESSAGE(same, mode);
+        }
+    }
+}
+
+TEST_SUITE("Window aggregation") {
+    TEST_CASE("rolling mean/min/max match a rescan") {
+        std::srand(11);
+        std::vector<uint64_t> ts;
+        std::vector<float> vs;
+        uint64_t t = 0;
+        for (int i = 0; i < 5000; ++i) {
+            t += 1 + std::rand() % 40;
+            ts.push_back(t);
+            vs.push_back(static_cast<float>(std::rand() % 2001 - 1000));
+        }
+
+        const float qs[2] = {0.5f, 0.9f};
+        can_WindowAggregator agg(1000, 250, qs, 2);
+        std::vector<can_WindowStats> out;
+        agg.push(ts.data(), vs.data(), ts.size(), out);
+        agg.flush(t, out);
+        REQUIRE(out.size() == t / 250);
+
+        bool same = true;
+        for (size_t k = 0; k < out.size(); ++k) {
+            const uint64_t end = out[k].timestamp;
+            std::vector<float> window;
+            double sum = 0;
+            for (size_t i = 0; i < ts.size(); ++i) {
+                if (ts[i] <= end && ts[i] + 1000 > end) {
+                    window.push_back(vs[i]);
+                    sum += vs[i];
+                }
+            }
+            same = same && out[k].count == window.size();
+            if (window.empty())
+                continue;
+            std::sort(window.begin(), window.end());
+            same = same && out[k].min == window.front() && out[k].max == window.back();
+            same = same && out[k].mean == doctest::Approx(sum / window.size());
+            // Sketch rank is exact; the bucket value is within 1% of the true sample
+            const float median = window[static_cast<size_t>(0.5f * (window.size() - 1))];
+            same = same && std::fabs(out[k].quantiles[0] - median) <= 0.011f * std::fabs(median) + 1e-6f;
+        }
+        CHECK(same);
+    }
+
+    TEST_CASE("quantile sketch supports removal") {
+        can_QuantileSketch sketch;
+        for (int i = 1; i <= 100; ++i)
+            sketch.add(static_cast<float>(i));
+        CHECK(sketch.quantile(0.5f) == doctest::Approx(50.0f).epsilon(0.01));
+        for (int i = 1; i <= 50; ++i)
+            sketch.remove(static_cast<float>(i));
+        CHECK(sketch.count() == 50);
+        CHECK(sketch.quantile(0.0f) == doctest::Approx(51.0f).epsilon(0.01));
+        CHECK(sketch.quantile(1.0f) == doctest::Approx(100.0f).epsilon(0.01));
+    }
+
+    TEST_CASE("quantile sketch range at a finer accuracy") {
+        can_QuantileSketch sketch(0.001f);
+        const float values[] = {-2e8f, 3e-8f, 0.5f, 40.0f, 7e8f};
+        for (const float v : values)
+            sketch.add(v);
+        for (size_t i = 0; i < 5; ++i)
+            CHECK(sketch.quantile(i / 4.0f) == doctest::Approx(values[i]).epsilon(0.001));
+    }
+
+    TEST_CASE("rate of change") {
+        const uint64_t ts[] = {0, 100000, 100000, 350000};
+        const float vs[] = {10.0f, 12.0f, 20.0f, 15.0f};
+        float rate[4];
+        can_rateOfChange(ts, vs, 4, rate);
+        CHECK(rate[0] == 0.0f);
+        CHECK(rate[1] == doctest::Approx(20.0f));
+        CHECK(rate[2] == 0.0f); // no time step
+        CHECK(rate[3] == doctest::Approx(-20.0f));
+    }
+
+    TEST_CASE("counter unwrapping across blocks") {
+        // 12-bit pulse counter, 0.5 units per count, 3 counts per 10 ms
+        const can_Signal counter = {0, 12, true, false, 0.5f, 0.0f};
+        const size_t n = 3000;
+        std::vector<uint64_t> ts(n);
+        std::vector<int64_t> raw(n);
+        for (size_t i = 0; i < n; ++i) {
+            ts[i] = 10000 * i;
+            uint8_t buf[8] = {0};
+            can_setRawSignal(buf, static_cast<int64_t>((4000 + 3 * i) % 4096), counter);
+            raw[i] = can_getRawSignal(buf, counter);
+        }
+        std::vector<double> unwrapped(n);
+        std::vector<float> rate(n);
+        can_unwrapCounter(ts.data(), raw.data(), n, counter, unwrapped.data(), rate.data());
+        bool same = true;
+        for (size_t i = 0; i < n; ++i) {
+            same = same && unwrapped[i] == 0.5 * (4000 + 3 * i);
+            same = same && (i == 0 ? rate[i] == 0.0f : rate[i] == doctest::Approx(150.0f));
+        }
+        CHECK(same);
+
+        std::vector<double> only(n);
+        can_unwrapCounter(ts.data(), raw.data(), n, counter, only.data(), nullptr);
+        CHECK(only.back() == unwrapped.back());
+    }
+
+    TEST_CASE("32-bit counters unwrap without losing counts") {
+        // Energy counter in 0.1 Wh, stepping by 1 or 3 counts and wrapping many times
+        const can_Signal counter = {0, 32, true, false, 0.1f, 0.0f};
+        const size_t n = 1000;
+        std::vector<uint64_t> ts(n);
+        std::vector<int64_t> raw(n);
+        uint64_t count = 0xFFFFFF00u;
+        for (size_t i = 0; i < n; ++i) {
+            ts[i] = 1000 * i;
+            raw[i] = static_cast<int64_t>(count & 0xFFFFFFFFu);
+            count += (i % 2) ? 3 : 0x7FFFFFFFu; // two steps of 2^31 - 1 wrap the counter
+        }
+        std::vector<double> unwrapped(n);
+        can_unwrapCounter(ts.data(), raw.data(), n, counter, unwrapped.data(), nullptr);
+        CHECK(unwrapped.back() == static_cast<double>(0xFFFFFF00u + (n / 2) * 0x7FFFFFFFull + (n / 2 - 1) * 3ull) * 0.1f);
+    }
+}
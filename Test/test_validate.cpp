@@ -0,0 +1,138 @@
+#include "../can_validate.hpp"
+
+#include "doctest.h"
+
+#include <cstdlib>
+
+TEST_SUITE("Validation") {
+    // Counter in the low nibble of byte 6, XOR checksum in byte 7
+    const can_Signal brakeSignals[] = {
+        {0, 16, true, false, 0.1f, 0.0f}, // pressure, bar
+        {16, 12, true, true, 0.5f, 0.0f}, // torque request, Nm
+    };
+    // Motorola counter in byte 0, sum checksum in byte 1 seeded with 0x5A
+    const can_Signal steerSignals[] = {
+        {24, 16, false, true, 0.1f, 0.0f}, // angle, deg, bytes 2-3
+    };
+    const can_CheckedMessage messages[] = {
+        {brakeSignals, 2, {{48, 4, true, false, 1.0f, 0.0f}, 1, CAN_CHECKSUM_XOR, 7, 8, 0x00}},
+        {steerSignals, 1, {{0, 8, false, false, 1.0f, 0.0f}, 3, CAN_CHECKSUM_SUM, 1, 5, 0x5A}},
+    };
+
+    void seal(uint8_t (&buf)[8], const can_Validator& v) {
+        uint8_t check = v.seed;
+        for (size_t i = 0; i < v.length; ++i) {
+            if (i == v.checksumByte)
+                continue;
+            check = static_cast<uint8_t>(v.checksum == CAN_CHECKSUM_XOR ? check ^ buf[i] : check + buf[i]);
+        }
+        buf[v.checksumByte] = check;
+    }
+
+    TEST_CASE("byte folds") {
+        std::srand(5);
+        for (int i = 0; i < 1000; ++i) {
+            uint8_t bytes[8];
+            uint8_t x = 0, s = 0;
+            for (int b = 0; b < 8; ++b) {
+                bytes[b] = static_cast<uint8_t>(std::rand());
+                x ^= bytes[b];
+                s = static_cast<uint8_t>(s + bytes[b]);
+            }
+            uint64_t word;
+            std::memcpy(&word, bytes, 8);
+            CHECK(can_xorBytes(word) == x);
+            CHECK(can_sumBytes(word) == s);
+        }
+    }
+
+    TEST_CASE("valid frames decode") {
+        can_MessageValidator<4, 8> validator;
+        REQUIRE(validator.add(messages[0]) == 0);
+        REQUIRE(validator.add(messages[1]) == 1);
+
+        float values[2];
+        for (uint8_t counter = 0; counter < 40; ++counter) {
+            uint8_t brake[8] = {0};
+            can_setSignal(brake, 12.5f, brakeSignals[0]);
+            can_setSignal(brake, -20.0f, brakeSignals[1]);
+            brake[6] = counter & 0x0F;
+            seal(brake, messages[0].validator);
+            REQUIRE(validator.decode(0, brake, 8, values) == CAN_CHECK_OK);
+            CHECK(values[0] == doctest::Approx(12.5f));
+            CHECK(values[1] == doctest::Approx(-20.0f));
+        }
+
+        uint8_t steer[8] = {0};
+        can_setSignal(steer, -123.4f, steerSignals[0]);
+        steer[0] = 200;
+        steer[6] = 0x77; // outside the checksum
+        seal(steer, messages[1].validator);
+        CHECK(validator.decode(1, steer, 4, values) == CAN_CHECK_LENGTH);
+        REQUIRE(validator.decode(1, steer, 5, values) == CAN_CHECK_OK);
+        CHECK(values[0] == doctest::Approx(-123.4f));
+    }
+
+    TEST_CASE("invalid frames are rejected before decoding") {
+        can_MessageValidator<1, 2> validator;
+        validator.add(messages[0]);
+        float values[2] = {-1.0f, -1.0f};
+        uint8_t buf[8] = {0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00};
+        seal(buf, messages[0].validator);
+        REQUIRE(validator.decode(0, buf, 8, values) == CAN_CHECK_OK);
+
+        buf[0] = 0x20; // payload changed, checksum stale
+        values[0] = -1.0f;
+        CHECK(validator.decode(0, buf, 8, values) == CAN_CHECK_CHECKSUM);
+        CHECK(values[0] == -1.0f);
+
+        buf[0] = 0x10; // same counter again
+        seal(buf, messages[0].validator);
+        CHECK(validator.decode(0, buf, 8, values) == CAN_CHECK_REPEATED);
+        CHECK(values[0] == -1.0f);
+
+        buf[6] = 0x06; // skipped two frames with maxDelta 1
+        seal(buf, messages[0].validator);
+        CHECK(validator.decode(0, buf, 8, values) == CAN_CHECK_SEQUENCE);
+
+        buf[6] = 0x07; // continuous again from the new reference
+        seal(buf, messages[0].validator);
+        CHECK(validator.decode(0, buf, 8, values) == CAN_CHECK_OK);
+        CHECK(values[0] == doctest::Approx(1.6f));
+
+        buf[6] = 0x00; // wraps at 16, a jump of 9
+        seal(buf, messages[0].validator);
+        CHECK(validator.decode(0, buf, 8, values) == CAN_CHECK_SEQUENCE);
+        validator.reset(0);
+        buf[6] = 0x0C;
+        seal(buf, messages[0].validator);
+        CHECK(validator.decode(0, buf, 8, values) == CAN_CHECK_OK);
+    }
+
+    TEST_CASE("counter tolerance and wrap") {
+        can_MessageValidator<1, 1> validator;
+        validator.add(messages[1]);
+        float value;
+        const uint8_t counters[] = {250, 253, 255, 2, 3, 3, 7};
+        const can_FrameCheck expected[] = {CAN_CHECK_OK, CAN_CHECK_OK, CAN_CHECK_OK, CAN_CHECK_OK, CAN_CHECK_OK, CAN_CHECK_REPEATED, CAN_CHECK_SEQUENCE};
+        for (size_t i = 0; i < sizeof(counters); ++i) {
+            uint8_t buf[8] = {counters[i], 0, 0x01, 0x02, 0, 0, 0, 0};
+            seal(buf, messages[1].validator);
+            CHECK(validator.decode(0, buf, 8, &value) == expected[i]);
+        }
+    }
+
+    TEST_CASE("malformed validators are refused") {
+        can_MessageValidator<2, 1> validator;
+        const can_CheckedMessage badByte = {nullptr, 0, {{0, 0, true, false, 1.0f, 0.0f}, 1, CAN_CHECKSUM_XOR, 4, 4, 0}};
+        CHECK(validator.add(badByte) == -1);
+        CHECK(validator.add(messages[0]) == -1); // two signals do not fit
+        const can_CheckedMessage plain = {steerSignals, 1, {{0, 0, true, false, 1.0f, 0.0f}, 0, CAN_CHECKSUM_NONE, 0, 0, 0}};
+        CHECK(validator.add(plain) == 0);
+        float value;
+        uint8_t buf[8] = {0, 0, 0xFF, 0xFE, 0, 0, 0, 0};
+        CHECK(validator.decode(0, buf, 0, &value) == CAN_CHECK_OK);
+        CHECK(validator.decode(0, buf, 0, &value) == CAN_CHECK_OK); // no counter to repeat
+        CHECK(value == doctest::Approx(-0.2f));
+    }
+}
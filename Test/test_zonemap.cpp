@@ -0,0 +1,132 @@
+#include "../can_zonemap.hpp"
+
+#include "doctest.h"
+
+TEST_SUITE("Zone maps") {
+    TEST_CASE("chunk pruning") {
+        const char* logPath = "Test/test_tmp_zm.ccol";
+        const char* mapPath = "Test/test_tmp_zm.ccol.zmap";
+
+        // EngineSpeed: 16 bit Intel at bit 0, 0.25 rpm/bit; Torque: signed 12 bit at bit 16
+        const can_Signal engine[2] = {
+            {0, 16, true, false, 0.25f, 0.0f},
+            {16, 12, true, true, 1.0f, 0.0f},
+        };
+
+        {
+            can_ZoneMapBuilder zones;
+            zones.addMessage(0x0CF00400, engine, 2, true);
+            REQUIRE(zones.open(mapPath));
+            can_ColumnarWriter writer(logPath, 100);
+            writer.setListener(&zones);
+
+            for (uint32_t i = 0; i < 1000; ++i) {
+                can_Frame frame;
+                std::memset(&frame, 0, sizeof(frame));
+                frame.id = 0x0CF00400;
+                frame.flags = CAN_FRAME_EXTENDED;
+                frame.len = 8;
+                frame.timestamp = i * 10000ULL;
+                // Speed ramps up to 7000 rpm over seven chunks, then back down
+                const uint32_t rpm = i < 700 ? i * 10 : (1400 - i) * 10;
+                can_setSignal<uint16_t>(can_frameData(frame), static_cast<uint16_t>(rpm * 4), 0, 16, true);
+                can_setSignal<int16_t>(can_frameData(frame), static_cast<int16_t>(500 - static_cast<int>(i)), 16, 12, true);
+                writer.write(frame);
+            }
+            CHECK(writer.close());
+            CHECK(zones.close());
+        }
+
+        can_ZoneMap zones;
+        REQUIRE(zones.open(mapPath));
+        REQUIRE(zones.size() == 10);
+        CHECK(zones.range(0, 0)->min == 0);
+        CHECK(zones.range(0, 0)->max == 990 * 4);
+        CHECK(zones.range(9, 1)->min == 500 - 999);
+        CHECK(zones.range(9, 1)->max == 500 - 900);
+
+        // EngineSpeed > 6000 rpm, i.e. raw > 24000
+        std::vector<uint64_t> offsets;
+        CHECK(zones.findChunks(0x0CF00400, 0, 24001, INT64_MAX, offsets) == 0); // standard ID of the same value
+        REQUIRE(zones.findChunks(0x0CF00400, 0, 24001, INT64_MAX, offsets, true) == 2);
+
+        can_ColumnarReader reader;
+        REQUIRE(reader.open(logPath));
+        size_t hits = 0;
+        for (size_t c = 0; c < offsets.size(); ++c) {
+            can_ChunkHeader header;
+            REQUIRE(reader.seek(offsets[c]));
+            REQUIRE(reader.nextChunk(header));
+            std::vector<can_Frame> frames(header.count);
+            REQUIRE(reader.decodeChunk(frames.data()));
+            for (size_t i = 0; i < frames.size(); ++i) {
+                if (can_getSignal(can_frameData(frames[i]), engine[0]) > 6000.0f)
+                    ++hits;
+            }
+        }
+        CHECK(hits == 99 + 100);
+
+        reader.close();
+        std::remove(logPath);
+        std::remove(mapPath);
+    }
+
+    TEST_CASE("raw signals are sign extended") {
+        const can_Signal sig = {4, 8, true, true, 0.5f, 10.0f};
+        uint8_t buf[8] = {0};
+        can_setSignal<int8_t>(buf, -3, 4, 8, true);
+        CHECK(can_getRawSignal(buf, sig) == -3);
+        CHECK(can_getSignal(buf, sig) == 8.5f);
+    }
+
+    TEST_CASE("FD signals, ID kinds and chunks without ranges") {
+        const char* logPath = "Test/test_tmp_zm_fd.ccol";
+        const char* mapPath = "Test/test_tmp_zm_fd.ccol.zmap";
+        const can_Signal fd[1] = {{80, 16, true, false, 1.0f, 0.0f}}; // bytes 10-11 of an FD frame
+        const can_Signal low[1] = {{0, 8, true, false, 1.0f, 0.0f}};
+
+        {
+            can_ZoneMapBuilder zones;
+            zones.addMessage(0x100, fd, 1);
+            zones.addMessage(0x100, low, 1, true);
+            REQUIRE(zones.open(mapPath));
+            can_ColumnarWriter writer(logPath, 50);
+            writer.setListener(&zones);
+            for (uint32_t i = 0; i < 100; ++i) {
+                can_Frame frame;
+                std::memset(&frame, 0, sizeof(frame));
+                frame.id = 0x100;
+                frame.flags = CAN_FRAME_FD;
+                frame.len = 16;
+                frame.timestamp = i * 1000ULL;
+                frame.data[10] = static_cast<uint8_t>(i);
+                frame.data[11] = 0x10;
+                frame.data[0] = 0xEE;
+                writer.write(frame);
+                frame.flags = CAN_FRAME_EXTENDED;
+                frame.len = 8;
+                frame.data[0] = static_cast<uint8_t>(i);
+                writer.write(frame);
+                frame.id = 0x200; // never registered
+                writer.write(frame);
+            }
+            CHECK(writer.close());
+            CHECK(zones.close());
+        }
+
+        can_ZoneMap zones;
+        REQUIRE(zones.open(mapPath));
+        std::vector<uint64_t> offsets;
+        // FD chunks hold 0x1000 + 0..49 and 0x1000 + 50..99
+        CHECK(zones.findChunks(0x100, 0, 0x1000 + 60, 0x1000 + 70, offsets) == 1);
+        CHECK(zones.findChunks(0x100, 0, 0x1000, 0x1000 + 99, offsets) == 2);
+        CHECK(zones.findChunks(0x100, 0, 0, 0xFFF, offsets) == 0);
+        // The extended frames of the same value are ranged by their own signal
+        CHECK(zones.findChunks(0x100, 0, 0, 10, offsets, true) == 1);
+        // No ranges were recorded for 0x200, so its chunks always qualify
+        CHECK(zones.findChunks(0x200, 0, 1000, 2000, offsets, true) == 2);
+
+        std::remove(logPath);
+        std::remove(mapPath);
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+// CANopen (CiA 301) PDO mapping.
+// A PDO mapping is a list of 32-bit entries (index, subindex, bit length), set
+// at configuration time through the mapping objects. can_PdoMap compiles such
+// a list against an object dictionary into a descriptor array holding the
+// object's address, mask and bit position, so packing a TPDO or unpacking an
+// RPDO is a single pass of shift/mask operations on one 64-bit word with no
+// mapping interpretation per frame.
+// Objects are stored in host byte order, which must be little endian like
+// CANopen itself. No heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+struct can_OdEntry {
+    uint16_t index;
+    uint8_t subIndex;
+    uint8_t size; // bytes of storage behind data, 1 to 8
+    void* data;
+};
+
+inline uint32_t can_pdoMapping(const uint16_t index, const uint8_t subIndex, const uint8_t bits) {
+    return (static_cast<uint32_t>(index) << 16) | (static_cast<uint32_t>(subIndex) << 8) | bits;
+}
+
+template <size_t Entries>
+class can_ObjectDictionary {
+  public:
+    // Returns false when full or the object already exists
+    bool add(const uint16_t index, const uint8_t subIndex, void* data, const uint8_t size) {
+        if (count_ >= Entries || size == 0 || size > 8 || find(index, subIndex))
+            return false;
+        const can_OdEntry entry = {index, subIndex, size, data};
+        entries_[count_++] = entry;
+        return true;
+    }
+
+    template <typename T>
+    bool add(const uint16_t index, const uint8_t subIndex, T& object) {
+        return add(index, subIndex, &object, sizeof(T));
+    }
+
+    const can_OdEntry* find(const uint16_t index, const uint8_t subIndex) const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (entries_[i].index == index && entries_[i].subIndex == subIndex)
+                return &entries_[i];
+        }
+        return nullptr;
+    }
+
+    size_t size() const { return count_; }
+
+  private:
+    can_OdEntry entries_[Entries];
+    size_t count_ = 0;
+};
+
+class can_PdoMap {
+  public:
+    static const size_t MAX_OBJECTS = 64; // one bit each at most
+
+    // Mapping entries with index 0x0001-0x0007 (the standard data types) are dummy
+    // entries that only reserve bits. Returns false, leaving the map empty, if an
+    // object is missing, too small for its bit length, or the PDO exceeds 8 bytes.
+    template <typename Dictionary>
+    bool compile(const uint32_t* mappings, const size_t count, const Dictionary& od) {
+        count_ = 0;
+        bits_ = 0;
+        size_t bit = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint16_t index = static_cast<uint16_t>(mappings[i] >> 16);
+            const uint8_t subIndex = static_cast<uint8_t>(mappings[i] >> 8);
+            const uint8_t length = static_cast<uint8_t>(mappings[i]);
+            if (length == 0 || bit + length > 64) {
+                count_ = 0;
+                return false;
+            }
+            if (index >= 0x0001 && index <= 0x0007) {
+                bit += length;
+                continue;
+            }
+            const can_OdEntry* entry = od.find(index, subIndex);
+            if (!entry || length > 8 * entry->size) {
+                count_ = 0;
+                return false;
+            }
+            Descriptor& d = descriptors_[count_++];
+            d.data = static_cast<uint8_t*>(entry->data);
+            d.mask = length < 64 ? (1ULL << length) - 1ULL : -1ULL;
+            d.shift = static_cast<uint8_t>(bit);
+            d.bytes = entry->size;
+            bit += length;
+        }
+        bits_ = static_cast<uint8_t>(bit);
+        return true;
+    }
+
+    size_t size() const { return count_; }
+    uint8_t length() const { return static_cast<uint8_t>((bits_ + 7) / 8); }
+
+    // Fill a TPDO from the dictionary; returns the PDO length. Unmapped bits are zero.
+    uint8_t pack(uint8_t (&buf)[8]) const {
+        uint64_t word = 0;
+        for (size_t i = 0; i < count_; ++i) {
+            const Descriptor& d = descriptors_[i];
+            uint64_t value = 0;
+            std::memcpy(&value, d.data, d.bytes);
+            word |= (value & d.mask) << d.shift;
+        }
+        std::memcpy(buf, &word, 8);
+        return length();
+    }
+
+    // Store a received RPDO into the dictionary; false, storing nothing, if it is
+    // shorter than the mapping
+    bool unpack(const uint8_t (&buf)[8], const uint8_t len) const {
+        if (len < length())
+            return false;
+        uint64_t word;
+        std::memcpy(&word, buf, 8);
+        for (size_t i = 0; i < count_; ++i) {
+            const Descriptor& d = descriptors_[i];
+            const uint64_t value = (word >> d.shift) & d.mask;
+            std::memcpy(d.data, &value, d.bytes);
+        }
+        return true;
+    }
+
+  private:
+    struct Descriptor {
+        uint8_t* data;
+        uint64_t mask;
+        uint8_t shift;
+        uint8_t bytes;
+    };
+
+    Descriptor descriptors_[MAX_OBJECTS];
+    size_t count_ = 0;
+    uint8_t bits_ = 0;
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+// Timestamp normalisation for multi-bus recordings.
+// Controllers with 16- or 32-bit hardware timestamps are unwrapped into a
+// continuous 64-bit count. Each bus clock is then related to a reference bus by
+// an online least-squares line fitted on shared events (a frame a gateway
+// forwards between the buses, a sync message seen on both), with optional
+// exponential forgetting so slowly changing drift is tracked. The fit is frozen
+// into a can_ClockMap that rewrites timestamps in place in a branch-free pass.
+// No heap.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+// Frames must arrive in capture order, with gaps shorter than one wrap period
+class can_TimestampUnwrapper {
+  public:
+    explicit can_TimestampUnwrapper(const unsigned bits = 64) { setBits(bits); }
+
+    void setBits(const unsigned bits) {
+        mask_ = bits < 64 ? (1ULL << bits) - 1ULL : -1ULL;
+        started_ = false;
+    }
+
+    uint64_t unwrap(const uint64_t raw) {
+        if (!started_) {
+            started_ = true;
+            value_ = raw & mask_;
+        } else {
+            value_ += (raw - last_) & mask_;
+        }
+        last_ = raw;
+        return value_;
+    }
+
+    void unwrap(uint64_t* timestamps, const size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            timestamps[i] = unwrap(timestamps[i]);
+    }
+
+  private:
+    uint64_t mask_;
+    uint64_t last_ = 0;
+    uint64_t value_ = 0;
+    bool started_ = false;
+};
+
+// reference = referenceOrigin + intercept + slope * (local - localOrigin)
+struct can_ClockMap {
+    int64_t localOrigin;
+    int64_t referenceOrigin;
+    double slope;
+    double intercept;
+};
+
+inline uint64_t can_mapTimestamp(const uint64_t local, const can_ClockMap& map) {
+    const double d = (static_cast<double>(static_cast<int64_t>(local - map.localOrigin)) * map.slope) + map.intercept;
+    return static_cast<uint64_t>(map.referenceOrigin + static_cast<int64_t>(d + (d < 0 ? -0.5 : 0.5)));
+}
+
+// No loop-carried state, so the compiler is free to vectorise it
+inline void can_mapTimestamps(uint64_t* timestamps, const size_t count, const can_ClockMap& map) {
+    for (size_t i = 0; i < count; ++i)
+        timestamps[i] = can_mapTimestamp(timestamps[i], map);
+}
+
+// Weighted least squares of reference time against local time, updated one pair
+// at a time. Means and co-moments are kept relative to the first pair so the
+// sums stay small enough for doubles at microsecond resolution.
+class can_ClockFit {
+  public:
+    // forgetting in (0, 1] scales down the weight of earlier pairs on every update
+    explicit can_ClockFit(const double forgetting = 1.0) : forgetting_(forgetting) {}
+
+    void add(const uint64_t local, const uint64_t reference) {
+        if (count_ == 0) {
+            localOrigin_ = static_cast<int64_t>(local);
+            referenceOrigin_ = static_cast<int64_t>(reference);
+        }
+        const double x = static_cast<double>(static_cast<int64_t>(local) - localOrigin_);
+        const double y = static_cast<double>(static_cast<int64_t>(reference) - referenceOrigin_);
+        weight_ = (forgetting_ * weight_) + 1.0;
+        const double dx = x - meanX_;
+        meanX_ += dx / weight_;
+        meanY_ += (y - meanY_) / weight_;
+        cxx_ = (forgetting_ * cxx_) + (dx * (x - meanX_));
+        cxy_ = (forgetting_ * cxy_) + (dx * (y - meanY_));
+        ++count_;
+    }
+
+    size_t size() const { return count_; }
+
+    // Reference ticks per local tick; 1 until the local times differ
+    double slope() const { return cxx_ > 0.0 ? cxy_ / cxx_ : 1.0; }
+
+    // Relative drift of the local clock, e.g. 50e-6 for 50 ppm slow
+    double drift() const { return slope() - 1.0; }
+
+    // Identity before the first pair
+    can_ClockMap map() const {
+        can_ClockMap m = {0, 0, 1.0, 0.0};
+        if (count_ == 0)
+            return m;
+        const double slope = this->slope();
+        m.localOrigin = localOrigin_;
+        m.referenceOrigin = referenceOrigin_;
+        m.slope = slope;
+        m.intercept = meanY_ - (slope * meanX_);
+        return m;
+    }
+
+    void reset() { *this = can_ClockFit(forgetting_); }
+
+  private:
+    double forgetting_;
+    double weight_ = 0.0;
+    double meanX_ = 0.0;
+    double meanY_ = 0.0;
+    double cxx_ = 0.0;
+    double cxy_ = 0.0;
+    int64_t localOrigin_ = 0;
+    int64_t referenceOrigin_ = 0;
+    size_t count_ = 0;
+};
+
+// Per-bus unwrapping and alignment onto the reference bus's clock, which is
+// left as it is. Frames of buses outside the table are not touched.
+template <size_t Buses>
+class can_ClockDomains {
+  public:
+    explicit can_ClockDomains(const uint8_t reference = 0, const double forgetting = 1.0) : reference_(reference) {
+        for (size_t i = 0; i < Buses; ++i) {
+            fits_[i] = can_ClockFit(forgetting);
+            maps_[i] = fits_[i].map();
+        }
+    }
+
+    // Width of the bus's hardware timestamp counter; 64 means no unwrapping
+    void setCounterBits(const uint8_t bus, const unsigned bits) { unwrappers_[bus].setBits(bits); }
+
+    // A shared event seen at unwrapped time local on bus and at reference on the
+    // reference bus. The bus's map is refitted.
+    void observe(const uint8_t bus, const uint64_t local, const uint64_t reference) {
+        fits_[bus].add(local, reference);
+        maps_[bus] = fits_[bus].map();
+    }
+
+    const can_ClockFit& fit(const uint8_t bus) const { return fits_[bus]; }
+    const can_ClockMap& map(const uint8_t bus) const { return maps_[bus]; }
+
+    // Replace hardware counter values with continuous counts
+    void unwrap(can_Frame* frames, const size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (frames[i].bus < Buses)
+                frames[i].timestamp = unwrappers_[frames[i].bus].unwrap(frames[i].timestamp);
+        }
+    }
+
+    // Rewrite unwrapped timestamps onto the reference clock
+    void align(can_Frame* frames, const size_t count) const {
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t bus = frames[i].bus;
+            if (bus < Buses && bus != reference_)
+                frames[i].timestamp = can_mapTimestamp(frames[i].timestamp, maps_[bus]);
+        }
+    }
+
+    void normalize(can_Frame* frames, const size_t count) {
+        unwrap(frames, count);
+        align(frames, count);
+    }
+
+  private:
+    can_TimestampUnwrapper unwrappers_[Buses];
+    can_ClockFit fits_[Buses];
+    can_ClockMap maps_[Buses];
+    uint8_t reference_;
+};
@@ -0,0 +1,491 @@
+#pragma once
+
+// Columnar compressed CAN log format.
+// Frames are grouped into chunks per (bus, ID, flags, length). Inside a chunk,
+// timestamps are stored as zig-zag delta-of-delta and each 64-bit payload lane
+// as the XOR against the previous payload, both bit-packed in blocks of 64 values.
+// Host-side only.
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include "can_helpers.hpp"
+#include "can_mmap.hpp"
+
+static const uint32_t CAN_COLUMNAR_MAGIC = 0x4C4F4343; // "CCOL"
+static const uint32_t CAN_COLUMNAR_VERSION = 1;
+static const size_t CAN_COLUMNAR_BLOCK = 64;
+
+struct can_ChunkHeader {
+    uint32_t size;  // bytes including this header
+    uint32_t count; // frames in the chunk
+    uint32_t id;
+    uint8_t flags;
+    uint8_t bus;
+    uint8_t len;
+    uint8_t reserved;
+    uint64_t minTimestamp;
+    uint64_t maxTimestamp;
+    uint32_t timestampBytes;
+    uint32_t payloadBytes;
+};
+
+class can_BitWriter {
+  public:
+    explicit can_BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint64_t value, const unsigned bits) {
+        if (bits == 0)
+            return;
+        if (bits < 64)
+            value &= (1ULL << bits) - 1ULL;
+        acc_ |= value << used_;
+        if (used_ + bits >= 64) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&acc_);
+            out_.insert(out_.end(), p, p + 8);
+            acc_ = used_ ? value >> (64 - used_) : 0;
+            used_ = used_ + bits - 64;
+        } else {
+            used_ += bits;
+        }
+    }
+
+    // Pad to the next byte boundary
+    void flush() {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&acc_);
+        out_.insert(out_.end(), p, p + (used_ + 7) / 8);
+        acc_ = 0;
+        used_ = 0;
+    }
+
+  private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    unsigned used_ = 0;
+};
+
+class can_BitReader {
+  public:
+    can_BitReader(const uint8_t* p, const uint8_t* end) : p_(p), end_(end) {}
+
+    uint64_t get(const unsigned bits) {
+        if (bits > 32) {
+            const uint64_t lo = get(32);
+            return lo | (get(bits - 32) << 32);
+        }
+        while (avail_ < bits && p_ < end_) {
+            acc_ |= static_cast<uint64_t>(*p_++) << avail_;
+            avail_ += 8;
+        }
+        const uint64_t value = acc_ & ((1ULL << bits) - 1ULL);
+        acc_ >>= bits;
+        avail_ = avail_ > bits ? avail_ - bits : 0;
+        return value;
+    }
+
+  private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint64_t acc_ = 0;
+    unsigned avail_ = 0;
+};
+
+inline unsigned can_bitWidth(const uint64_t v) {
+    return v ? 64 - __builtin_clzll(v) : 0;
+}
+
+inline uint64_t can_zigzag(const int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t can_unzigzag(const uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+// Gather the bits selected by mask into the low bits of the result
+inline uint64_t can_extractBits(const uint64_t value, uint64_t mask) {
+#ifdef __BMI2__
+    return __builtin_ia32_pext_di(value, mask);
+#else
+    uint64_t out = 0;
+    unsigned pos = 0;
+    while (mask) {
+        const unsigned start = __builtin_ctzll(mask);
+        const uint64_t run = mask >> start;
+        const unsigned len = (~run == 0) ? 64 : __builtin_ctzll(~run);
+        const uint64_t runMask = len < 64 ? (1ULL << len) - 1ULL : -1ULL;
+        out |= ((value >> start) & runMask) << pos;
+        pos += len;
+        mask = (start + len < 64) ? mask & ~(runMask << start) : 0;
+    }
+    return out;
+#endif
+}
+
+// Scatter the low bits of value into the positions selected by mask
+inline uint64_t can_depositBits(uint64_t value, uint64_t mask) {
+#ifdef __BMI2__
+    return __builtin_ia32_pdep_di(value, mask);
+#else
+    uint64_t out = 0;
+    while (mask) {
+        const unsigned start = __builtin_ctzll(mask);
+        const uint64_t run = mask >> start;
+        const unsigned len = (~run == 0) ? 64 : __builtin_ctzll(~run);
+        const uint64_t runMask = len < 64 ? (1ULL << len) - 1ULL : -1ULL;
+        out |= (value & runMask) << start;
+        value = len < 64 ? value >> len : 0;
+        mask = (start + len < 64) ? mask & ~(runMask << start) : 0;
+    }
+    return out;
+#endif
+}
+
+// Sees every chunk as it is written, before compression
+class can_ChunkListener {
+  public:
+    virtual ~can_ChunkListener() {}
+
+    // payloads holds (header.len + 7) / 8 little-endian words per frame, lane-interleaved
+    virtual void onChunk(const can_ChunkHeader& header, uint64_t offset, const uint64_t* timestamps, const uint64_t* payloads) = 0;
+};
+
+class can_ColumnarWriter {
+  public:
+    can_ColumnarWriter() {}
+    explicit can_ColumnarWriter(const char* path, const size_t chunkFrames = 4096) { open(path, chunkFrames); }
+    ~can_ColumnarWriter() { close(); }
+
+    bool open(const char* path, const size_t chunkFrames = 4096) {
+        close();
+        file_ = std::fopen(path, "wb");
+        if (!file_)
+            return false;
+        chunkFrames_ = chunkFrames ? chunkFrames : 1;
+        const uint32_t header[2] = {CAN_COLUMNAR_MAGIC, CAN_COLUMNAR_VERSION};
+        ok_ = std::fwrite(header, sizeof(header), 1, file_) == 1;
+        offset_ = sizeof(header);
+        return ok_;
+    }
+
+    bool isOpen() const { return file_ != nullptr; }
+
+    void setListener(can_ChunkListener* listener) { listener_ = listener; }
+
+    bool write(const can_Frame& frame) {
+        if (!file_)
+            return false;
+        const uint8_t flags = frame.flags & (CAN_FRAME_EXTENDED | CAN_FRAME_RTR | CAN_FRAME_ERROR | CAN_FRAME_FD);
+        const uint64_t key = frame.id | (static_cast<uint64_t>(flags) << 32) | (static_cast<uint64_t>(frame.bus) << 40) | (static_cast<uint64_t>(frame.len) << 48);
+
+        Pending& chunk = pending_[key];
+        if (chunk.timestamps.empty()) {
+            chunk.id = frame.id;
+            chunk.flags = flags;
+            chunk.bus = frame.bus;
+            chunk.len = frame.len;
+        }
+        chunk.timestamps.push_back(frame.timestamp);
+        const size_t lanes = (frame.len + 7) / 8;
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, frame.data + lane * 8, 8);
+            chunk.payloads.push_back(word);
+        }
+
+        if (chunk.timestamps.size() >= chunkFrames_)
+            return writeChunk(chunk);
+        return ok_;
+    }
+
+    bool write(const can_Frame* frames, const size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!write(frames[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // Write out every partially filled chunk
+    bool flush() {
+        for (std::map<uint64_t, Pending>::iterator it = pending_.begin(); it != pending_.end(); ++it) {
+            if (!it->second.timestamps.empty())
+                writeChunk(it->second);
+        }
+        return ok_;
+    }
+
+    bool close() {
+        if (!file_)
+            return true;
+        flush();
+        ok_ = (std::fclose(file_) == 0) && ok_;
+        file_ = nullptr;
+        pending_.clear();
+        return ok_;
+    }
+
+  private:
+    struct Pending {
+        uint32_t id;
+        uint8_t flags;
+        uint8_t bus;
+        uint8_t len;
+        std::vector<uint64_t> timestamps;
+        std::vector<uint64_t> payloads; // lane-interleaved, (len + 7) / 8 words per frame
+    };
+
+    can_ColumnarWriter(const can_ColumnarWriter&);
+    can_ColumnarWriter& operator=(const can_ColumnarWriter&);
+
+    static void encodeTimestamps(const std::vector<uint64_t>& ts, std::vector<uint8_t>& out) {
+        const uint8_t* first = reinterpret_cast<const uint8_t*>(&ts[0]);
+        out.insert(out.end(), first, first + 8);
+
+        std::vector<uint64_t> dod(ts.size() - 1);
+        int64_t prevDelta = 0;
+        for (size_t i = 1; i < ts.size(); ++i) {
+            const int64_t delta = static_cast<int64_t>(ts[i] - ts[i - 1]);
+            dod[i - 1] = can_zigzag(delta - prevDelta);
+            prevDelta = delta;
+        }
+
+        can_BitWriter bits(out);
+        for (size_t block = 0; block < dod.size(); block += CAN_COLUMNAR_BLOCK) {
+            const size_t end = block + CAN_COLUMNAR_BLOCK < dod.size() ? block + CAN_COLUMNAR_BLOCK : dod.size();
+            uint64_t all = 0;
+            for (size_t i = block; i < end; ++i)
+                all |= dod[i];
+            const unsigned width = can_bitWidth(all);
+            out.push_back(static_cast<uint8_t>(width));
+            for (size_t i = block; i < end; ++i)
+                bits.put(dod[i], width);
+            bits.flush();
+        }
+    }
+
+    static void encodePayloads(const Pending& chunk, std::vector<uint8_t>& out) {
+        const size_t lanes = (chunk.len + 7) / 8;
+        const size_t count = chunk.timestamps.size();
+        if (lanes == 0)
+            return;
+        const uint8_t* first = reinterpret_cast<const uint8_t*>(&chunk.payloads[0]);
+        out.insert(out.end(), first, first + lanes * 8);
+
+        can_BitWriter bits(out);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            for (size_t block = 1; block < count; block += CAN_COLUMNAR_BLOCK) {
+                const size_t end = block + CAN_COLUMNAR_BLOCK < count ? block + CAN_COLUMNAR_BLOCK : count;
+                uint64_t mask = 0;
+                for (size_t i = block; i < end; ++i)
+                    mask |= chunk.payloads[i * lanes + lane] ^ chunk.payloads[(i - 1) * lanes + lane];
+                const uint8_t* m = reinterpret_cast<const uint8_t*>(&mask);
+                out.insert(out.end(), m, m + 8);
+                const unsigned width = __builtin_popcountll(mask);
+                for (size_t i = block; i < end; ++i) {
+                    const uint64_t x = chunk.payloads[i * lanes + lane] ^ chunk.payloads[(i - 1) * lanes + lane];
+                    bits.put(can_extractBits(x, mask), width);
+                }
+                bits.flush();
+            }
+        }
+    }
+
+    bool writeChunk(Pending& chunk) {
+        scratch_.clear();
+        encodeTimestamps(chunk.timestamps, scratch_);
+        const size_t timestampBytes = scratch_.size();
+        encodePayloads(chunk, scratch_);
+
+        can_ChunkHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.size = static_cast<uint32_t>(sizeof(header) + scratch_.size());
+        header.count = static_cast<uint32_t>(chunk.timestamps.size());
+        header.id = chunk.id;
+        header.flags = chunk.flags;
+        header.bus = chunk.bus;
+        header.len = chunk.len;
+        header.minTimestamp = header.maxTimestamp = chunk.timestamps[0];
+        for (size_t i = 1; i < chunk.timestamps.size(); ++i) {
+            if (chunk.timestamps[i] < header.minTimestamp)
+                header.minTimestamp = chunk.timestamps[i];
+            if (chunk.timestamps[i] > header.maxTimestamp)
+                header.maxTimestamp = chunk.timestamps[i];
+        }
+        header.timestampBytes = static_cast<uint32_t>(timestampBytes);
+        header.payloadBytes = static_cast<uint32_t>(scratch_.size() - timestampBytes);
+
+        if (listener_)
+            listener_->onChunk(header, offset_, chunk.timestamps.data(), chunk.payloads.data());
+        offset_ += header.size;
+        ok_ = std::fwrite(&header, sizeof(header), 1, file_) == 1 && ok_;
+        ok_ = std::fwrite(scratch_.data(), 1, scratch_.size(), file_) == scratch_.size() && ok_;
+        chunk.timestamps.clear();
+        chunk.payloads.clear();
+        return ok_;
+    }
+
+    std::FILE* file_ = nullptr;
+    can_ChunkListener* listener_ = nullptr;
+    uint64_t offset_ = 0;
+    std::map<uint64_t, Pending> pending_;
+    std::vector<uint8_t> scratch_;
+    size_t chunkFrames_ = 4096;
+    bool ok_ = false;
+};
+
+// Memory-mapped reader. Chunk headers can be scanned without touching the
+// compressed data, so chunks of unwanted IDs are skipped for free.
+class can_ColumnarReader {
+  public:
+    bool open(const char* path) {
+        close();
+        if (!file_.open(path) || file_.size() < 8) {
+            close();
+            return false;
+        }
+        uint32_t header[2];
+        std::memcpy(header, file_.data(), sizeof(header));
+        if (header[0] != CAN_COLUMNAR_MAGIC || header[1] != CAN_COLUMNAR_VERSION) {
+            close();
+            return false;
+        }
+        rewind();
+        return true;
+    }
+
+    void close() {
+        file_.close();
+        pos_ = 0;
+        chunk_ = nullptr;
+    }
+
+    bool isOpen() const { return file_.isOpen(); }
+
+    void rewind() {
+        pos_ = 8;
+        chunk_ = nullptr;
+    }
+
+    // Byte offset of the next chunk, usable with seek()
+    size_t offset() const { return pos_; }
+
+    bool seek(const size_t offset) {
+        if (offset < 8 || offset > file_.size())
+            return false;
+        pos_ = offset;
+        chunk_ = nullptr;
+        return true;
+    }
+
+    // Advance to the next chunk and return its header; false at the end of the
+    // file or at a chunk whose header is inconsistent (corrupt or truncated file)
+    bool nextChunk(can_ChunkHeader& header) {
+        if (pos_ + sizeof(header) > file_.size())
+            return false;
+        std::memcpy(&header, file_.data() + pos_, sizeof(header));
+        if (header.size < sizeof(header) || pos_ + header.size > file_.size() || header.count == 0 || header.len > sizeof(can_Frame().data))
+            return false;
+        if (static_cast<uint64_t>(sizeof(header)) + header.timestampBytes + header.payloadBytes != header.size)
+            return false;
+        chunk_ = file_.data() + pos_;
+        pos_ += header.size;
+        return true;
+    }
+
+    // Decode the chunk returned by the last nextChunk() into header.count frames
+    bool decodeChunk(can_Frame* frames) const {
+        if (!chunk_)
+            return false;
+        can_ChunkHeader header;
+        std::memcpy(&header, chunk_, sizeof(header));
+        const uint8_t* ts = chunk_ + sizeof(header);
+        const uint8_t* payload = ts + header.timestampBytes;
+        const uint8_t* end = payload + header.payloadBytes;
+
+        for (uint32_t i = 0; i < header.count; ++i) {
+            frames[i].id = header.id;
+            frames[i].flags = header.flags;
+            frames[i].bus = header.bus;
+            frames[i].len = header.len;
+        }
+        return decodeTimestamps(ts, payload, header.count, frames) && decodePayloads(payload, end, header, frames);
+    }
+
+  private:
+    static bool decodeTimestamps(const uint8_t* p, const uint8_t* end, const uint32_t count, can_Frame* frames) {
+        if (p + 8 > end)
+            return false;
+        uint64_t t;
+        std::memcpy(&t, p, 8);
+        p += 8;
+        frames[0].timestamp = t;
+
+        int64_t delta = 0;
+        for (uint32_t block = 1; block < count; block += CAN_COLUMNAR_BLOCK) {
+            const uint32_t blockEnd = block + CAN_COLUMNAR_BLOCK < count ? block + CAN_COLUMNAR_BLOCK : count;
+            if (p >= end)
+                return false;
+            const unsigned width = *p++;
+            if (width > 64)
+                return false;
+            can_BitReader bits(p, end);
+            for (uint32_t i = block; i < blockEnd; ++i) {
+                delta += can_unzigzag(bits.get(width));
+                t += delta;
+                frames[i].timestamp = t;
+            }
+            p += ((blockEnd - block) * width + 7) / 8;
+        }
+        return p <= end;
+    }
+
+    static bool decodePayloads(const uint8_t* p, const uint8_t* end, const can_ChunkHeader& header, can_Frame* frames) {
+        const size_t lanes = (header.len + 7) / 8;
+        for (uint32_t i = 0; i < header.count; ++i)
+            std::memset(frames[i].data, 0, sizeof(frames[i].data));
+        if (lanes == 0)
+            return true;
+        if (p + lanes * 8 > end)
+            return false;
+
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, p + lane * 8, 8);
+            std::memcpy(frames[0].data + lane * 8, &word, 8);
+        }
+        p += lanes * 8;
+
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, frames[0].data + lane * 8, 8);
+            for (uint32_t block = 1; block < header.count; block += CAN_COLUMNAR_BLOCK) {
+                const uint32_t blockEnd = block + CAN_COLUMNAR_BLOCK < header.count ? block + CAN_COLUMNAR_BLOCK : header.count;
+                if (p + 8 > end)
+                    return false;
+                uint64_t mask;
+                std::memcpy(&mask, p, 8);
+                p += 8;
+                const unsigned width = __builtin_popcountll(mask);
+                can_BitReader bits(p, end);
+                for (uint32_t i = block; i < blockEnd; ++i) {
+                    word ^= can_depositBits(bits.get(width), mask);
+                    std::memcpy(frames[i].data + lane * 8, &word, 8);
+                }
+                p += ((blockEnd - block) * width + 7) / 8;
+            }
+        }
+
+        // Clear the padding of a partial last lane
+        for (uint32_t i = 0; i < header.count; ++i)
+            std::memset(frames[i].data + header.len, 0, lanes * 8 - header.len);
+        return p <= end;
+    }
+
+    can_MappedFile file_;
+    const uint8_t* chunk_ = nullptr;
+    size_t pos_ = 0;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+// Reception deadline monitoring for many messages.
+// Every watched message owns a timer on a timing wheel. A received frame re-arms
+// that timer in O(1) and an expiry fires its callback directly, so nothing is
+// scanned per tick however many messages are watched. When a can_LatestStore is
+// attached, timed-out messages are invalidated there and their signals read as
+// invalid until the next frame arrives. No heap.
+//
+// Not thread-safe: receive() and advance() must be called from one context, e.g.
+// both from the CAN task, or with receptions queued to it from the RX interrupt.
+// Only advance() moves time forward and fires expiries, so the receive path never
+// runs callbacks for other messages.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_store.hpp"
+#include "can_timer.hpp"
+
+// Called with timedOut true when a message misses its deadline and false when it
+// is received again afterwards
+typedef void (*can_DeadlineFn)(void* context, size_t message, bool timedOut, uint64_t now);
+
+// Ticks are the unit of the timestamps passed in, e.g. microseconds. Message
+// indices are shared with the attached store.
+template <size_t Messages>
+class can_DeadlineMonitor {
+  public:
+    explicit can_DeadlineMonitor(can_LatestStore<Messages>* store = nullptr, const can_DeadlineFn callback = nullptr, void* context = nullptr)
+        : store_(store), callback_(callback), context_(context) {
+        for (size_t i = 0; i < Messages; ++i) {
+            watches_[i].owner = this;
+            watches_[i].timeout = 0;
+            watches_[i].expired = false;
+            can_initTimer(watches_[i].timer, &can_DeadlineMonitor::onExpiry, &watches_[i]);
+        }
+    }
+
+    // Watch a message that must arrive at least every timeout ticks, typically a
+    // small multiple of its cycle time. The first deadline runs from now, so a
+    // message that never shows up times out too.
+    bool watch(const size_t message, const uint64_t timeout, const uint64_t now) {
+        if (message >= Messages || timeout == 0)
+            return false;
+        Watch& w = watches_[message];
+        w.timeout = timeout;
+        w.expired = false;
+        wheel_.schedule(w.timer, now + timeout);
+        return true;
+    }
+
+    void unwatch(const size_t message) {
+        if (message >= Messages)
+            return;
+        wheel_.cancel(watches_[message].timer);
+        watches_[message].timeout = 0;
+        watches_[message].expired = false;
+    }
+
+    // A frame of the message arrived. Pass the frames received up to now before
+    // calling advance(now), so one arriving exactly at its deadline is in time.
+    void receive(const size_t message, const uint64_t now) {
+        if (message >= Messages)
+            return;
+        Watch& w = watches_[message];
+        if (w.timeout == 0)
+            return;
+        wheel_.schedule(w.timer, now + w.timeout);
+        if (w.expired) {
+            w.expired = false;
+            --expiredCount_;
+            if (callback_)
+                callback_(context_, message, false, now);
+        }
+    }
+
+    // Store the frame in the attached store and re-arm the message's deadline
+    void receive(const size_t message, const uint8_t (&buf)[8], const uint64_t now) {
+        if (message >= Messages)
+            return;
+        if (store_)
+            store_->write(message, buf, now);
+        receive(message, now);
+    }
+
+    // Fire the deadlines that passed up to now; returns how many
+    size_t advance(const uint64_t now) { return wheel_.advance(now); }
+
+    bool expired(const size_t message) const { return watches_[message].expired; }
+    size_t expiredCount() const { return expiredCount_; }
+
+  private:
+    can_DeadlineMonitor(const can_DeadlineMonitor&);
+    can_DeadlineMonitor& operator=(const can_DeadlineMonitor&);
+
+    struct Watch {
+        can_DeadlineMonitor* owner;
+        can_Timer timer;
+        uint64_t timeout;
+        bool expired;
+    };
+
+    static void onExpiry(void* context, can_Timer&, const uint64_t now) {
+        Watch& w = *static_cast<Watch*>(context);
+        can_DeadlineMonitor& m = *w.owner;
+        const size_t message = static_cast<size_t>(&w - m.watches_);
+        w.expired = true;
+        ++m.expiredCount_;
+        if (m.store_)
+            m.store_->invalidate(message);
+        if (m.callback_)
+            m.callback_(m.context_, message, true, now);
+    }
+
+    Watch watches_[Messages];
+    can_TimerWheel<> wheel_;
+    can_LatestStore<Messages>* store_;
+    can_DeadlineFn callback_;
+    void* context_;
+    size_t expiredCount_ = 0;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+// AUTOSAR E2E protection, profiles 1, 2, 5 and 11 (DataID mode "both").
+// The CRCs are table-driven with slicing-by-4: four bytes per step through four
+// 256-entry tables, built once on first use. can_E2EProtector plugs into
+// can_MessageStage::pack() so counter and CRC are written while the frame is
+// packed; can_E2EChecker verifies a received payload and only then decodes its
+// signals. No heap.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+enum can_E2EProfile : uint8_t {
+    CAN_E2E_P01, // CRC8 SAE J1850 over DataID and data, 4-bit counter 0-14
+    CAN_E2E_P02, // CRC8H2F over data and a per-counter DataID, 4-bit counter 0-15
+    CAN_E2E_P05, // CRC16 CCITT over data and DataID, 8-bit counter
+    CAN_E2E_P11, // as profile 1 with the standard CRC start and final XOR
+};
+
+enum can_E2EStatus : uint8_t {
+    CAN_E2E_OK,
+    CAN_E2E_INITIAL,        // first valid frame, counter taken as reference
+    CAN_E2E_OK_SOME_LOST,   // counter jumped by no more than maxDeltaCounter
+    CAN_E2E_REPEATED,       // same counter as the previous frame
+    CAN_E2E_WRONG_SEQUENCE, // counter jumped too far
+    CAN_E2E_ERROR,          // wrong CRC or length, or an invalid configuration
+};
+
+// Whether the signals of a frame with this status may be used
+inline bool can_e2eAccept(const can_E2EStatus status) { return status <= CAN_E2E_OK_SOME_LOST; }
+
+struct can_E2EConfig {
+    can_E2EProfile profile;
+    uint8_t length;            // protected payload bytes
+    uint16_t dataId;           // profiles 1, 5 and 11
+    const uint8_t* dataIdList; // profile 2: 16 DataIDs indexed by the counter
+    uint8_t crcOffset;         // byte of the CRC (profiles 1, 5, 11; profile 2 uses byte 0)
+    uint8_t counterOffset;     // bit of the 4-bit counter (profiles 1, 11; profile 2 uses bit 8)
+    uint8_t maxDeltaCounter;
+};
+
+// Sender: next counter to send. Receiver: last counter seen, once synced.
+struct can_E2EState {
+    uint8_t counter;
+    bool synced;
+};
+
+// Slicing-by-4 tables; entry [k][x] is the register after x is followed by k zero bytes
+struct can_CrcTables {
+    uint8_t crc8[4][256];    // polynomial 0x1D (SAE J1850)
+    uint8_t crc8h2f[4][256]; // polynomial 0x2F
+    uint16_t crc16[4][256];  // polynomial 0x1021 (CCITT)
+
+    can_CrcTables() {
+        for (unsigned x = 0; x < 256; ++x) {
+            uint8_t a = static_cast<uint8_t>(x), b = static_cast<uint8_t>(x);
+            uint16_t c = static_cast<uint16_t>(x << 8);
+            for (int bit = 0; bit < 8; ++bit) {
+                a = static_cast<uint8_t>(a & 0x80 ? (a << 1) ^ 0x1D : a << 1);
+                b = static_cast<uint8_t>(b & 0x80 ? (b << 1) ^ 0x2F : b << 1);
+                c = static_cast<uint16_t>(c & 0x8000 ? (c << 1) ^ 0x1021 : c << 1);
+            }
+            crc8[0][x] = a;
+            crc8h2f[0][x] = b;
+            crc16[0][x] = c;
+        }
+        for (int k = 1; k < 4; ++k) {
+            for (unsigned x = 0; x < 256; ++x) {
+                crc8[k][x] = crc8[0][crc8[k - 1][x]];
+                crc8h2f[k][x] = crc8h2f[0][crc8h2f[k - 1][x]];
+                crc16[k][x] = static_cast<uint16_t>((crc16[k - 1][x] << 8) ^ crc16[0][crc16[k - 1][x] >> 8]);
+            }
+        }
+    }
+};
+
+inline const can_CrcTables& can_crcTables() {
+    static const can_CrcTables tables;
+    return tables;
+}
+
+inline uint8_t can_crc8Slice(const uint8_t (*table)[256], uint8_t crc, const uint8_t* data, size_t size) {
+    for (; size >= 4; data += 4, size -= 4)
+        crc = table[3][crc ^ data[0]] ^ table[2][data[1]] ^ table[1][data[2]] ^ table[0][data[3]];
+    while (size--)
+        crc = table[0][crc ^ *data++];
+    return crc;
+}
+
+// The update functions run the bare register: the caller applies the start value
+// and final XOR, which lets a CRC continue across several buffers.
+// CRC-8/SAE-J1850 is start 0xFF, final XOR 0xFF; CRC-8H2F the same.
+inline uint8_t can_crc8Update(const uint8_t crc, const uint8_t* data, const size_t size) { return can_crc8Slice(can_crcTables().crc8, crc, data, size); }
+inline uint8_t can_crc8h2fUpdate(const uint8_t crc, const uint8_t* data, const size_t size) { return can_crc8Slice(can_crcTables().crc8h2f, crc, data, size); }
+
+// CRC-16/CCITT-FALSE is start 0xFFFF, no final XOR
+inline uint16_t can_crc16Update(uint16_t crc, const uint8_t* data, size_t size) {
+    const uint16_t(*table)[256] = can_crcTables().crc16;
+    for (; size >= 4; data += 4, size -= 4)
+        crc = table[3][(crc >> 8) ^ data[0]] ^ table[2][(crc & 0xFF) ^ data[1]] ^ table[1][data[2]] ^ table[0][data[3]];
+    while (size--)
+        crc = static_cast<uint16_t>((crc << 8) ^ table[0][(crc >> 8) ^ *data++]);
+    return crc;
+}
+
+// Whether the CRC and counter fields of a configuration lie inside its payload
+inline bool can_e2eValid(const can_E2EConfig& config) {
+    switch (config.profile) {
+    case CAN_E2E_P01:
+    case CAN_E2E_P11:
+        // The counter nibble must fit in one byte other than the CRC's
+        return config.crcOffset < config.length && config.counterOffset / 8 < config.length && config.counterOffset % 8 <= 4 && config.counterOffset / 8 != config.crcOffset;
+    case CAN_E2E_P02:
+        return config.length >= 2 && config.dataIdList != nullptr;
+    case CAN_E2E_P05:
+        return config.crcOffset + 2 < config.length;
+    }
+    return false;
+}
+
+// CRC of a profile over the payload, skipping the CRC field itself
+inline uint16_t can_e2eCrc(const can_E2EConfig& config, const uint8_t* data, const uint8_t counter) {
+    const uint8_t id[2] = {static_cast<uint8_t>(config.dataId), static_cast<uint8_t>(config.dataId >> 8)};
+    const size_t end = config.length;
+    switch (config.profile) {
+    case CAN_E2E_P01:
+    case CAN_E2E_P11: {
+        const size_t at = config.crcOffset;
+        uint8_t crc = config.profile == CAN_E2E_P01 ? 0x00 : 0xFF;
+        crc = can_crc8Update(crc, id, 2);
+        crc = can_crc8Update(crc, data, at);
+        crc = can_crc8Update(crc, data + at + 1, end - at - 1);
+        return config.profile == CAN_E2E_P01 ? crc : crc ^ 0xFF;
+    }
+    case CAN_E2E_P02: {
+        uint8_t crc = can_crc8h2fUpdate(0xFF, data + 1, end - 1);
+        crc = can_crc8h2fUpdate(crc, &config.dataIdList[counter & 0x0F], 1);
+        return crc ^ 0xFF;
+    }
+    case CAN_E2E_P05: {
+        const size_t at = config.crcOffset;
+        uint16_t crc = can_crc16Update(0xFFFF, data, at);
+        crc = can_crc16Update(crc, data + at + 2, end - at - 2);
+        return can_crc16Update(crc, id, 2);
+    }
+    }
+    return 0;
+}
+
+// Write counter and CRC, then advance the counter; false if the payload is too
+// short or the configuration is invalid
+inline bool can_e2eProtect(const can_E2EConfig& config, can_E2EState& state, uint8_t* data, const size_t size) {
+    if (size < config.length || !can_e2eValid(config))
+        return false;
+    const uint8_t counter = state.counter;
+    switch (config.profile) {
+    case CAN_E2E_P01:
+    case CAN_E2E_P11: {
+        uint8_t& byte = data[config.counterOffset / 8];
+        const unsigned shift = config.counterOffset % 8;
+        byte = static_cast<uint8_t>((byte & ~(0x0F << shift)) | (counter << shift));
+        data[config.crcOffset] = static_cast<uint8_t>(can_e2eCrc(config, data, counter));
+        state.counter = counter >= 14 ? 0 : counter + 1;
+        break;
+    }
+    case CAN_E2E_P02:
+        data[1] = static_cast<uint8_t>((data[1] & 0xF0) | counter);
+        data[0] = static_cast<uint8_t>(can_e2eCrc(config, data, counter));
+        state.counter = (counter + 1) & 0x0F;
+        break;
+    case CAN_E2E_P05: {
+        data[config.crcOffset + 2] = counter;
+        const uint16_t crc = can_e2eCrc(config, data, counter);
+        data[config.crcOffset] = static_cast<uint8_t>(crc);
+        data[config.crcOffset + 1] = static_cast<uint8_t>(crc >> 8);
+        state.counter = static_cast<uint8_t>(counter + 1);
+        break;
+    }
+    }
+    return true;
+}
+
+// Verify a received payload and track its counter. The counter is only taken
+// over from frames with a valid CRC. An invalid configuration fails every frame.
+inline can_E2EStatus can_e2eCheck(const can_E2EConfig& config, can_E2EState& state, const uint8_t* data, const size_t size) {
+    if (size != config.length || !can_e2eValid(config))
+        return CAN_E2E_ERROR;
+    uint8_t counter;
+    unsigned range;
+    uint16_t crc;
+    switch (config.profile) {
+    case CAN_E2E_P01:
+    case CAN_E2E_P11:
+        counter = (data[config.counterOffset / 8] >> (config.counterOffset % 8)) & 0x0F;
+        range = 15;
+        crc = data[config.crcOffset];
+        if (counter >= range)
+            return CAN_E2E_ERROR;
+        break;
+    case CAN_E2E_P02:
+        counter = data[1] & 0x0F;
+        range = 16;
+        crc = data[0];
+        break;
+    case CAN_E2E_P05:
+        counter = data[config.crcOffset + 2];
+        range = 256;
+        crc = static_cast<uint16_t>(data[config.crcOffset] | (data[config.crcOffset + 1] << 8));
+        break;
+    default:
+        return CAN_E2E_ERROR;
+    }
+    if (crc != can_e2eCrc(config, data, counter))
+        return CAN_E2E_ERROR;
+
+    const unsigned delta = (counter + range - state.counter) % range;
+    const bool synced = state.synced;
+    state.counter = counter;
+    state.synced = true;
+    if (!synced)
+        return CAN_E2E_INITIAL;
+    if (delta == 0)
+        return CAN_E2E_REPEATED;
+    if (delta == 1)
+        return CAN_E2E_OK;
+    return delta <= config.maxDeltaCounter ? CAN_E2E_OK_SOME_LOST : CAN_E2E_WRONG_SEQUENCE;
+}
+
+// Sender side, for can_MessageStage::pack(frame, protection)
+class can_E2EProtector {
+  public:
+    explicit can_E2EProtector(const can_E2EConfig& config) : config_(config) {}
+
+    bool protect(uint8_t* data, const size_t size) { return can_e2eProtect(config_, state_, data, size); }
+    uint8_t counter() const { return state_.counter; }
+
+  private:
+    can_E2EConfig config_;
+    can_E2EState state_ = {0, false};
+};
+
+// Receiver side: check first, decode only what passed
+class can_E2EChecker {
+  public:
+    explicit can_E2EChecker(const can_E2EConfig& config) : config_(config) {}
+
+    can_E2EStatus check(const uint8_t* data, const size_t size) { return status_ = can_e2eCheck(config_, state_, data, size); }
+
+    // Decodes the signals only if the frame is accepted; values are left untouched otherwise
+    can_E2EStatus decode(const uint8_t* data, const size_t size, const can_Signal* signals, const size_t count, float* values) {
+        if (can_e2eAccept(check(data, size))) {
+            for (size_t i = 0; i < count; ++i)
+                values[i] = can_getSignal(data, size, signals[i]);
+        }
+        return status_;
+    }
+
+    can_E2EStatus status() const { return status_; }
+
+  private:
+    can_E2EConfig config_;
+    can_E2EState state_ = {0, false};
+    can_E2EStatus status_ = CAN_E2E_ERROR;
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+// Signal gateway: copies signals from frames received on one bus into
+// differently laid-out frames for another.
+// Routes are compiled once into fused operations. A signal that sits at the same
+// place in both frames becomes part of a masked word copy; other routes with the
+// same scaling move raw bits with one extract and one deposit; only routes that
+// rescale go through the physical value. All routes from one source into one
+// destination are applied in a single read-modify-write of the destination.
+// Fixed capacity, no heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+// Messages are dense indices chosen by the application. Routes into the same
+// destination frame must not overlap.
+struct can_Route {
+    size_t srcMessage;
+    can_Signal src;
+    size_t dstMessage;
+    can_Signal dst;
+};
+
+template <size_t Routes>
+class can_Gateway {
+  public:
+    // Returns the route number, or -1 when full. Call compile() after the last add().
+    int add(const can_Route& route) {
+        if (count_ >= Routes)
+            return -1;
+        routes_[count_] = route;
+        compiled_ = false;
+        return static_cast<int>(count_++);
+    }
+
+    void compile() {
+        // Order routes by (source, destination) so each pair forms one batch
+        size_t order[Routes];
+        for (size_t i = 0; i < count_; ++i) {
+            size_t j = i;
+            while (j > 0 && pairLess(routes_[i], routes_[order[j - 1]])) {
+                order[j] = order[j - 1];
+                --j;
+            }
+            order[j] = i;
+        }
+
+        batchCount_ = 0;
+        opCount_ = 0;
+        for (size_t k = 0; k < count_; ++k) {
+            const can_Route& r = routes_[order[k]];
+            if (batchCount_ == 0 || batches_[batchCount_ - 1].src != r.srcMessage || batches_[batchCount_ - 1].dst != r.dstMessage) {
+                Batch& b = batches_[batchCount_++];
+                b.src = r.srcMessage;
+                b.dst = r.dstMessage;
+                b.copyMask = 0;
+                b.first = opCount_;
+                b.count = 0;
+            }
+            Batch& b = batches_[batchCount_ - 1];
+            const bool sameScale = r.src.factor == r.dst.factor && r.src.offset == r.dst.offset;
+            if (sameScale && r.src.startBit == r.dst.startBit && r.src.length == r.dst.length && r.src.isIntel == r.dst.isIntel) {
+                b.copyMask |= can_signalMask(r.src);
+                continue;
+            }
+            Op& op = ops_[opCount_++];
+            op.src = r.src;
+            op.dst = r.dst;
+            op.rescale = !sameScale;
+            op.srcMask = r.src.length < 64 ? (1ULL << r.src.length) - 1ULL : -1ULL;
+            op.dstMask = r.dst.length < 64 ? (1ULL << r.dst.length) - 1ULL : -1ULL;
+            op.srcShift = shiftOf(r.src);
+            op.dstShift = shiftOf(r.dst);
+            ++b.count;
+        }
+        compiled_ = true;
+    }
+
+    size_t size() const { return count_; }
+
+    // Apply every route fed by a received source frame. dst holds the destination
+    // payloads indexed by message; the indices of the updated ones are written to
+    // touched (if given) and their number returned.
+    size_t apply(const size_t srcMessage, const uint8_t (&src)[8], uint8_t (*dst)[8], size_t* touched = nullptr) {
+        if (!compiled_)
+            compile();
+        size_t lo = 0, hi = batchCount_;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (batches_[mid].src < srcMessage)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        uint64_t s;
+        std::memcpy(&s, src, 8);
+        const uint64_t sMoto = __builtin_bswap64(s);
+        size_t n = 0;
+        for (size_t i = lo; i < batchCount_ && batches_[i].src == srcMessage; ++i) {
+            const Batch& b = batches_[i];
+            uint64_t intelClear = b.copyMask, intelBits = s & b.copyMask, motoClear = 0, motoBits = 0;
+            for (size_t k = b.first; k < b.first + b.count; ++k) {
+                const Op& op = ops_[k];
+                uint64_t raw = ((op.src.isIntel ? s : sMoto) >> op.srcShift) & op.srcMask;
+                if (op.src.isSigned)
+                    raw = static_cast<uint64_t>(can_signExtend(raw, op.src.length));
+                if (op.rescale) {
+                    const float value = static_cast<int64_t>(raw) * op.src.factor + op.src.offset;
+                    raw = static_cast<uint64_t>(can_toRaw(value, op.dst));
+                }
+                if (op.dst.isIntel) {
+                    intelClear |= op.dstMask << op.dstShift;
+                    intelBits |= (raw & op.dstMask) << op.dstShift;
+                } else {
+                    motoClear |= op.dstMask << op.dstShift;
+                    motoBits |= (raw & op.dstMask) << op.dstShift;
+                }
+            }
+
+            uint64_t d;
+            std::memcpy(&d, dst[b.dst], 8);
+            d = (d & ~intelClear) | intelBits;
+            if (motoClear)
+                d = __builtin_bswap64((__builtin_bswap64(d) & ~motoClear) | motoBits);
+            std::memcpy(dst[b.dst], &d, 8);
+            if (touched)
+                touched[n] = b.dst;
+            ++n;
+        }
+        return n;
+    }
+
+  private:
+    struct Op {
+        can_Signal src;
+        can_Signal dst;
+        uint64_t srcMask;
+        uint64_t dstMask;
+        uint8_t srcShift;
+        uint8_t dstShift;
+        bool rescale;
+    };
+
+    struct Batch {
+        size_t src;
+        size_t dst;
+        uint64_t copyMask; // bits copied verbatim, in payload order
+        size_t first;
+        size_t count;
+    };
+
+    static bool pairLess(const can_Route& a, const can_Route& b) {
+        return a.srcMessage < b.srcMessage || (a.srcMessage == b.srcMessage && a.dstMessage < b.dstMessage);
+    }
+
+    static uint8_t shiftOf(const can_Signal& sig) {
+        return static_cast<uint8_t>(sig.isIntel ? sig.startBit : (56 - sig.startBit + (2 * (sig.startBit % 8))));
+    }
+
+    can_Route routes_[Routes];
+    Op ops_[Routes];
+    Batch batches_[Routes];
+    size_t count_ = 0;
+    size_t opCount_ = 0;
+    size_t batchCount_ = 0;
+    bool compiled_ = false;
+};
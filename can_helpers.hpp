@@ -68,3 +68,295 @@ void can_setSignal(uint8_t (&buf)[8], const float& val, const size_t startBit, c
     T scaledVal = static_cast<T>((val - offset) / factor);
     can_setSignal<T>(buf, scaledVal, startBit, length, isIntel);
 }
+
+enum can_FrameFlags : uint8_t {
+    CAN_FRAME_EXTENDED = 0x01,
+    CAN_FRAME_RTR = 0x02,
+    CAN_FRAME_ERROR = 0x04,
+    CAN_FRAME_FD = 0x08,
+    CAN_FRAME_BRS = 0x10,
+    CAN_FRAME_ESI = 0x20,
+};
+
+// A timestamped classic or FD frame, as produced by the log readers.
+// The payload is always zero-padded to the full 64 bytes.
+struct can_Frame {
+    uint64_t timestamp; // microseconds
+    uint32_t id;        // 11 or 29 bit identifier, without flag bits
+    uint8_t len;        // payload length in bytes
+    uint8_t flags;      // can_FrameFlags
+    uint8_t bus;        // interface the frame was captured on
+    uint8_t data[64];
+};
+
+// View the first 8 bytes of a frame as a classic CAN buffer
+inline const uint8_t (&can_frameData(const can_Frame& frame))[8] {
+    return *reinterpret_cast<const uint8_t(*)[8]>(frame.data);
+}
+
+inline uint8_t (&can_frameData(can_Frame& frame))[8] {
+    return *reinterpret_cast<uint8_t(*)[8]>(frame.data);
+}
+
+// Hands one frame to a driver; returns false if it could not be queued
+typedef bool (*can_TransmitFn)(void* context, uint32_t id, bool extended, const uint8_t (&data)[8], uint8_t len);
+
+template <typename T>
+void can_getSignalBatch(const can_Frame* frames, const size_t count, T* out, const size_t startBit, const size_t length, const bool isIntel) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = can_getSignal<T>(can_frameData(frames[i]), startBit, length, isIntel);
+    }
+}
+
+template <typename T>
+void can_getSignalBatch(const can_Frame* frames, const size_t count, float* out, const size_t startBit, const size_t length, const bool isIntel, const float factor, const float offset) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = can_getSignal<T>(can_frameData(frames[i]), startBit, length, isIntel, factor, offset);
+    }
+}
+
+// Static description of one signal inside a message
+struct can_Signal {
+    uint16_t startBit;
+    uint8_t length;
+    bool isIntel;
+    bool isSigned;
+    float factor;
+    float offset;
+};
+
+inline int64_t can_signExtend(const uint64_t raw, const size_t length) {
+    const uint64_t signBit = 1ULL << (length - 1);
+    return length < 64 ? static_cast<int64_t>((raw ^ signBit) - signBit) : static_cast<int64_t>(raw);
+}
+
+// Raw integer value of a signal, sign-extended when the signal is signed
+inline int64_t can_getRawSignal(const uint8_t (&buf)[8], const can_Signal& sig) {
+    const uint64_t raw = can_getSignal<uint64_t>(buf, sig.startBit, sig.length, sig.isIntel);
+    return sig.isSigned ? can_signExtend(raw, sig.length) : static_cast<int64_t>(raw);
+}
+
+inline float can_getSignal(const uint8_t (&buf)[8], const can_Signal& sig) {
+    return (can_getRawSignal(buf, sig) * sig.factor) + sig.offset;
+}
+
+// Raw value to encode for a physical value; truncates like can_setSignal
+inline int64_t can_toRaw(const float value, const can_Signal& sig) {
+    return static_cast<int64_t>((value - sig.offset) / sig.factor);
+}
+
+// Bits above the signal length are dropped, so negative raw values encode as two's complement
+inline void can_setRawSignal(uint8_t (&buf)[8], const int64_t raw, const can_Signal& sig) {
+    const uint64_t mask = sig.length < 64 ? (1ULL << sig.length) - 1ULL : -1ULL;
+    can_setSignal<uint64_t>(buf, static_cast<uint64_t>(raw) & mask, sig.startBit, sig.length, sig.isIntel);
+}
+
+inline void can_setSignal(uint8_t (&buf)[8], const float value, const can_Signal& sig) {
+    can_setRawSignal(buf, can_toRaw(value, sig), sig);
+}
+
+// Signals in payloads of any length, e.g. CAN FD frames or reassembled transport
+// protocol messages. Same bit numbering as the 8-byte API; the signal must span at
+// most 8 bytes. Bytes past size read as zero and are never written.
+inline size_t can_signalWindow(const can_Signal& sig) {
+    const size_t byte = sig.startBit / 8;
+    return sig.isIntel ? byte : (byte >= 7 ? byte - 7 : 0);
+}
+
+inline int64_t can_getRawSignal(const uint8_t* data, const size_t size, const can_Signal& sig) {
+    const size_t first = can_signalWindow(sig);
+    uint8_t buf[8] = {0};
+    if (first < size)
+        std::memcpy(buf, data + first, size - first < 8 ? size - first : 8);
+    can_Signal local = sig;
+    local.startBit = static_cast<uint16_t>(sig.startBit - 8 * first);
+    return can_getRawSignal(buf, local);
+}
+
+inline float can_getSignal(const uint8_t* data, const size_t size, const can_Signal& sig) {
+    return (can_getRawSignal(data, size, sig) * sig.factor) + sig.offset;
+}
+
+inline void can_setRawSignal(uint8_t* data, const size_t size, const int64_t raw, const can_Signal& sig) {
+    const size_t first = can_signalWindow(sig);
+    if (first >= size)
+        return;
+    const size_t bytes = size - first < 8 ? size - first : 8;
+    uint8_t buf[8] = {0};
+    std::memcpy(buf, data + first, bytes);
+    can_Signal local = sig;
+    local.startBit = static_cast<uint16_t>(sig.startBit - 8 * first);
+    can_setRawSignal(buf, raw, local);
+    std::memcpy(data + first, buf, bytes);
+}
+
+inline void can_setSignal(uint8_t* data, const size_t size, const float value, const can_Signal& sig) {
+    can_setRawSignal(data, size, can_toRaw(value, sig), sig);
+}
+
+enum can_CompareOp {
+    CAN_LT,
+    CAN_LE,
+    CAN_GT,
+    CAN_GE,
+    CAN_EQ,
+    CAN_NE,
+};
+
+// A physical-value comparison compiled to the raw integer domain.
+// A payload word matches when its raw field lies in [lo, hi] (outside of it when invert is set).
+struct can_RawPredicate {
+    uint64_t mask;
+    uint64_t signBit; // 0 for unsigned signals
+    uint64_t lo;      // two's complement of the lower bound
+    uint64_t span;    // hi - lo
+    uint8_t shift;
+    bool isIntel;
+    bool invert;
+};
+
+inline bool can_comparePhysical(const float value, const can_CompareOp op, const float threshold) {
+    switch (op) {
+        case CAN_LT: return value < threshold;
+        case CAN_LE: return value <= threshold;
+        case CAN_GT: return value > threshold;
+        case CAN_GE: return value >= threshold;
+        case CAN_EQ: return value == threshold;
+        case CAN_NE: return value != threshold;
+    }
+    return false;
+}
+
+// Evaluated exactly like can_getSignal(buf, sig), so compiled bounds agree with it bit for bit
+inline bool can_rawSatisfies(const int64_t raw, const can_Signal& sig, const can_CompareOp op, const float threshold) {
+    return can_comparePhysical((raw * sig.factor) + sig.offset, op, threshold);
+}
+
+// Smallest raw value in [lo, hi] where the comparison result becomes `want`, assuming it changes at most once
+inline bool can_findRawBound(const can_Signal& sig, const can_CompareOp op, const float threshold, const bool want, int64_t lo, int64_t hi, int64_t& bound) {
+    if (can_rawSatisfies(hi, sig, op, threshold) != want)
+        return false;
+    while (lo < hi) {
+        const int64_t mid = lo + static_cast<int64_t>((static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo)) / 2);
+        if (can_rawSatisfies(mid, sig, op, threshold) == want)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    bound = lo;
+    return true;
+}
+
+// Every raw value the signal can hold
+inline void can_rawDomain(const can_Signal& sig, int64_t& lo, int64_t& hi) {
+    const bool wide = sig.length >= 64;
+    lo = sig.isSigned ? (wide ? INT64_MIN : -(1LL << (sig.length - 1))) : 0;
+    hi = sig.isSigned ? (wide ? INT64_MAX : (1LL << (sig.length - 1)) - 1) : (sig.length >= 63 ? INT64_MAX : (1LL << sig.length) - 1);
+}
+
+// Raw range [lo, hi] matching an ordering comparison. Returns false if no raw value matches.
+inline bool can_rawRange(const can_Signal& sig, const can_CompareOp op, const float threshold, int64_t& lo, int64_t& hi) {
+    can_rawDomain(sig, lo, hi);
+    if (sig.factor == 0.0f)
+        return can_rawSatisfies(0, sig, op, threshold);
+
+    // The physical value is monotonic in the raw value; its direction decides which end of the range is open
+    const bool rising = (op == CAN_GT || op == CAN_GE) == (sig.factor > 0.0f);
+    int64_t bound;
+    if (rising) {
+        if (!can_findRawBound(sig, op, threshold, true, lo, hi, bound))
+            return false;
+        lo = bound;
+    } else {
+        if (can_findRawBound(sig, op, threshold, false, lo, hi, bound)) {
+            if (bound == lo)
+                return false;
+            hi = bound - 1;
+        }
+    }
+    return true;
+}
+
+// Unsigned 64-bit signals are limited to the int64_t range
+inline can_RawPredicate can_compilePredicate(const can_Signal& sig, const can_CompareOp op, const float threshold) {
+    can_RawPredicate p;
+    p.mask = sig.length < 64 ? (1ULL << sig.length) - 1ULL : -1ULL;
+    p.signBit = sig.isSigned ? 1ULL << (sig.length - 1) : 0;
+    p.shift = static_cast<uint8_t>(sig.isIntel ? sig.startBit : (56 - sig.startBit + (2 * (sig.startBit % 8))));
+    p.isIntel = sig.isIntel;
+    p.invert = false;
+
+    int64_t lo, hi;
+    bool any;
+    if (op == CAN_EQ || op == CAN_NE) {
+        int64_t geLo, geHi;
+        any = can_rawRange(sig, CAN_GE, threshold, geLo, geHi) && can_rawRange(sig, CAN_LE, threshold, lo, hi);
+        if (any) {
+            if (geLo > lo)
+                lo = geLo;
+            if (geHi < hi)
+                hi = geHi;
+            any = lo <= hi;
+        }
+        p.invert = (op == CAN_NE);
+    } else {
+        any = can_rawRange(sig, op, threshold, lo, hi);
+    }
+
+    if (!any) {
+        // Every raw value lies inside the signal's own range, so invert the full range to match nothing
+        can_rawDomain(sig, lo, hi);
+        p.invert = !p.invert;
+    }
+    p.lo = static_cast<uint64_t>(lo);
+    p.span = static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo);
+    return p;
+}
+
+inline bool can_matchWord(uint64_t word, const can_RawPredicate& p) {
+    const uint64_t raw = (((word >> p.shift) & p.mask) ^ p.signBit) - p.signBit;
+    return ((raw - p.lo) <= p.span) != p.invert;
+}
+
+inline bool can_matches(const uint8_t (&buf)[8], const can_RawPredicate& p) {
+    uint64_t word;
+    std::memcpy(&word, buf, 8);
+    return can_matchWord(p.isIntel ? word : __builtin_bswap64(word), p);
+}
+
+// One result byte per payload word, words as loaded from memory. Branch-free so GCC can vectorize it.
+inline size_t can_matchWords(const uint64_t* words, const size_t count, const can_RawPredicate& p, uint8_t* out) {
+    size_t hits = 0;
+    if (p.isIntel) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = can_matchWord(words[i], p);
+            hits += out[i];
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = can_matchWord(__builtin_bswap64(words[i]), p);
+            hits += out[i];
+        }
+    }
+    return hits;
+}
+
+inline size_t can_filterBatch(const can_Frame* frames, const size_t count, const can_RawPredicate& p, uint8_t* out) {
+    size_t hits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = can_matches(can_frameData(frames[i]), p);
+        hits += out[i];
+    }
+    return hits;
+}
+
+// Bits occupied by a signal, in the payload as loaded into a little-endian uint64_t
+inline uint64_t can_signalMask(const size_t startBit, const size_t length, const bool isIntel) {
+    const uint64_t mask = length < 64 ? (1ULL << length) - 1ULL : -1ULL;
+    const uint64_t shift = isIntel ? startBit : (56 - startBit + (2 * (startBit % 8)));
+    return isIntel ? (mask << shift) : __builtin_bswap64(mask << shift);
+}
+
+inline uint64_t can_signalMask(const can_Signal& sig) {
+    return can_signalMask(sig.startBit, sig.length, sig.isIntel);
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+// Offline inverted index over PCAP / PCAPNG logs.
+// The log is cut into blocks of consecutive frames. For every CAN ID the index
+// keeps a delta + varint compressed posting list of the blocks it appears in,
+// and every block keeps its file offset and time range, so extracting one
+// message or one time window seeks straight to the relevant blocks.
+// Host-side only.
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "can_pcap.hpp"
+
+static const uint32_t CAN_INDEX_MAGIC = 0x58444943; // "CIDX"
+static const uint32_t CAN_INDEX_VERSION = 1;
+
+// Extended identifiers are keyed with this bit set
+static const uint32_t CAN_INDEX_EXTENDED = 0x80000000u;
+
+struct can_IndexBlock {
+    uint64_t offset; // reader offset of the first frame
+    uint64_t minTimestamp;
+    uint64_t maxTimestamp;
+    uint32_t frames;
+    uint32_t reserved;
+};
+
+struct can_IndexEntry {
+    uint32_t key; // id | CAN_INDEX_EXTENDED
+    uint32_t blocks;
+    uint64_t postingOffset;
+    uint64_t postingBytes;
+};
+
+inline uint32_t can_indexKey(const uint32_t id, const bool extended) {
+    return extended ? (id | CAN_INDEX_EXTENDED) : id;
+}
+
+inline void can_putVarint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline bool can_getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (unsigned shift = 0; shift < 35 && p < end; shift += 7) {
+        const uint8_t b = *p++;
+        v |= static_cast<uint32_t>(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Index one byte range of a log. Frames are read from the first record at or after
+// begin up to the first record at or after end. headers are the log's
+// can_PcapReader::headerBlocks(), shared so every shard sees late PCAPNG interfaces.
+struct can_IndexShard {
+    std::vector<can_IndexBlock> blocks;
+    std::map<uint32_t, std::vector<uint32_t> > postings; // local block numbers
+
+    bool build(const char* logPath, const std::vector<size_t>& headers, const size_t begin, const size_t end, const size_t framesPerBlock) {
+        can_PcapReader reader;
+        if (!reader.open(logPath))
+            return false;
+        reader.setHeaderBlocks(headers);
+        const size_t stop = reader.sync(end);
+        if (!reader.seek(reader.sync(begin)))
+            return true;
+
+        can_Frame frame;
+        while (reader.next(frame)) {
+            // Records that are not frames are skipped by next(), so the bound applies to the frame itself
+            const size_t offset = reader.frameOffset();
+            if (offset >= stop)
+                break;
+            if (blocks.empty() || blocks.back().frames >= framesPerBlock) {
+                can_IndexBlock block;
+                std::memset(&block, 0, sizeof(block));
+                block.offset = offset;
+                block.minTimestamp = block.maxTimestamp = frame.timestamp;
+                blocks.push_back(block);
+            }
+            can_IndexBlock& block = blocks.back();
+            ++block.frames;
+            if (frame.timestamp < block.minTimestamp)
+                block.minTimestamp = frame.timestamp;
+            if (frame.timestamp > block.maxTimestamp)
+                block.maxTimestamp = frame.timestamp;
+
+            std::vector<uint32_t>& list = postings[can_indexKey(frame.id, frame.flags & CAN_FRAME_EXTENDED)];
+            const uint32_t blockNumber = static_cast<uint32_t>(blocks.size() - 1);
+            if (list.empty() || list.back() != blockNumber)
+                list.push_back(blockNumber);
+        }
+        return true;
+    }
+};
+
+// Build the index with one shard per thread; threads = 0 uses every hardware thread
+inline bool can_buildIndex(const char* logPath, const char* indexPath, unsigned threads = 0, const size_t framesPerBlock = 1024) {
+    can_PcapReader probe;
+    if (!probe.open(logPath))
+        return false;
+    const size_t size = probe.size();
+    const std::vector<size_t> headers = probe.headerBlocks();
+    probe.close();
+
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    const size_t minShard = 1 << 20;
+    if (size / threads < minShard)
+        threads = static_cast<unsigned>(size / minShard) + 1;
+
+    std::vector<can_IndexShard> shards(threads);
+    std::vector<char> ok(threads, 0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        const size_t begin = size / threads * i;
+        const size_t end = (i + 1 == threads) ? size : size / threads * (i + 1);
+        workers.push_back(std::thread([&, i, begin, end]() {
+            ok[i] = shards[i].build(logPath, headers, begin, end, framesPerBlock);
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+
+    // Concatenate the shards, renumbering blocks
+    std::vector<can_IndexBlock> blocks;
+    std::map<uint32_t, std::vector<uint32_t> > postings;
+    for (unsigned i = 0; i < threads; ++i) {
+        if (!ok[i])
+            return false;
+        const uint32_t base = static_cast<uint32_t>(blocks.size());
+        blocks.insert(blocks.end(), shards[i].blocks.begin(), shards[i].blocks.end());
+        for (std::map<uint32_t, std::vector<uint32_t> >::const_iterator it = shards[i].postings.begin(); it != shards[i].postings.end(); ++it) {
+            std::vector<uint32_t>& list = postings[it->first];
+            for (size_t j = 0; j < it->second.size(); ++j)
+                list.push_back(base + it->second[j]);
+        }
+        shards[i] = can_IndexShard();
+    }
+
+    std::vector<can_IndexEntry> entries;
+    std::vector<uint8_t> lists;
+    for (std::map<uint32_t, std::vector<uint32_t> >::const_iterator it = postings.begin(); it != postings.end(); ++it) {
+        can_IndexEntry entry;
+        entry.key = it->first;
+        entry.blocks = static_cast<uint32_t>(it->second.size());
+        entry.postingOffset = lists.size();
+        uint32_t prev = 0;
+        for (size_t j = 0; j < it->second.size(); ++j) {
+            can_putVarint(lists, it->second[j] - prev);
+            prev = it->second[j];
+        }
+        entry.postingBytes = lists.size() - entry.postingOffset;
+        entries.push_back(entry);
+    }
+
+    std::FILE* f = std::fopen(indexPath, "wb");
+    if (!f)
+        return false;
+    const uint32_t header[4] = {CAN_INDEX_MAGIC, CAN_INDEX_VERSION, static_cast<uint32_t>(blocks.size()), static_cast<uint32_t>(entries.size())};
+    bool written = std::fwrite(header, sizeof(header), 1, f) == 1;
+    written = written && (blocks.empty() || std::fwrite(blocks.data(), sizeof(can_IndexBlock), blocks.size(), f) == blocks.size());
+    written = written && (entries.empty() || std::fwrite(entries.data(), sizeof(can_IndexEntry), entries.size(), f) == entries.size());
+    written = written && (lists.empty() || std::fwrite(lists.data(), 1, lists.size(), f) == lists.size());
+    return (std::fclose(f) == 0) && written;
+}
+
+class can_LogIndex {
+  public:
+    bool open(const char* indexPath) {
+        close();
+        if (!file_.open(indexPath) || file_.size() < 16)
+            return false;
+        uint32_t header[4];
+        std::memcpy(header, file_.data(), sizeof(header));
+        const size_t listsAt = 16 + header[2] * sizeof(can_IndexBlock) + header[3] * sizeof(can_IndexEntry);
+        if (header[0] != CAN_INDEX_MAGIC || header[1] != CAN_INDEX_VERSION || listsAt > file_.size()) {
+            close();
+            return false;
+        }
+        blockCount_ = header[2];
+        entryCount_ = header[3];
+        blocks_ = file_.data() + 16;
+        entries_ = blocks_ + blockCount_ * sizeof(can_IndexBlock);
+        lists_ = file_.data() + listsAt;
+        listsBytes_ = file_.size() - listsAt;
+        return true;
+    }
+
+    void close() {
+        file_.close();
+        blockCount_ = entryCount_ = 0;
+        listsBytes_ = 0;
+    }
+
+    size_t blockCount() const { return blockCount_; }
+
+    can_IndexBlock block(const size_t i) const {
+        can_IndexBlock b;
+        std::memcpy(&b, blocks_ + i * sizeof(b), sizeof(b));
+        return b;
+    }
+
+    // Blocks containing the message, in file order. False for a corrupt list.
+    bool postings(const uint32_t id, const bool extended, std::vector<uint32_t>& out) const {
+        out.clear();
+        const uint32_t key = can_indexKey(id, extended);
+        size_t lo = 0, hi = entryCount_;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (entry(mid).key < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == entryCount_)
+            return false;
+        const can_IndexEntry e = entry(lo);
+        if (e.key != key)
+            return false;
+
+        // Checked as integers, before any pointer is formed from the file's fields
+        if (e.postingOffset > listsBytes_ || e.postingBytes > listsBytes_ - e.postingOffset)
+            return false;
+        const uint8_t* p = lists_ + e.postingOffset;
+        const uint8_t* end = p + e.postingBytes;
+        uint64_t blockNumber = 0;
+        for (uint32_t i = 0; i < e.blocks; ++i) {
+            uint32_t delta;
+            if (!can_getVarint(p, end, delta))
+                return false;
+            blockNumber += delta;
+            if (blockNumber >= blockCount_)
+                return false;
+            out.push_back(static_cast<uint32_t>(blockNumber));
+        }
+        return true;
+    }
+
+    // First block that may hold frames at or after the timestamp, for time-ordered logs
+    size_t findTime(const uint64_t timestamp) const {
+        size_t lo = 0, hi = blockCount_;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (block(mid).maxTimestamp < timestamp)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+  private:
+    can_IndexEntry entry(const size_t i) const {
+        can_IndexEntry e;
+        std::memcpy(&e, entries_ + i * sizeof(e), sizeof(e));
+        return e;
+    }
+
+    can_MappedFile file_;
+    const uint8_t* blocks_ = nullptr;
+    const uint8_t* entries_ = nullptr;
+    const uint8_t* lists_ = nullptr;
+    uint64_t listsBytes_ = 0;
+    size_t blockCount_ = 0;
+    size_t entryCount_ = 0;
+};
+
+// Append every frame of one message to out, reading only the blocks that contain it
+inline bool can_extractMessage(can_PcapReader& reader, const can_LogIndex& index, const uint32_t id, const bool extended, std::vector<can_Frame>& out) {
+    std::vector<uint32_t> blocks;
+    if (!index.postings(id, extended, blocks))
+        return false;
+    can_Frame frame;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const can_IndexBlock block = index.block(blocks[i]);
+        if (!reader.seek(block.offset))
+            return false;
+        for (uint32_t n = 0; n < block.frames && reader.next(frame); ++n) {
+            if (frame.id == id && ((frame.flags & CAN_FRAME_EXTENDED) != 0) == extended)
+                out.push_back(frame);
+        }
+    }
+    return true;
+}
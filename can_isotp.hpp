@@ -0,0 +1,424 @@
+#pragma once
+
+// ISO-TP (ISO 15765-2) segmentation and reassembly over classic CAN, normal
+// addressing, for any number of channels.
+// Consecutive frames are copied once, straight from the received frame into
+// the caller's buffer: either a fixed buffer per channel or one handed out by
+// a callback when the first frame announces the length. Single frames are
+// delivered straight from the received frame. Messages are sent straight from
+// the caller's span, which must stay valid until the onSent callback. Flow
+// control (block size, STmin, WAIT up to N_WFTmax, overflow) and the N_Bs / N_Cr
+// timeouts run on a timing wheel driven by the caller's clock. Decode signals from the
+// reassembled payload with the length-generic can_getSignal. No heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+#include "can_timer.hpp"
+
+static const uint32_t CAN_ISOTP_N_TIMEOUT = 1000; // N_Bs and N_Cr, in milliseconds
+static const uint8_t CAN_ISOTP_WFT_MAX = 10;      // default N_WFTmax
+
+enum can_IsoTpResult {
+    CAN_ISOTP_OK,
+    CAN_ISOTP_TIMEOUT,  // no flow control / consecutive frame in time
+    CAN_ISOTP_OVERFLOW, // the receiver has no room for the message
+    CAN_ISOTP_SEQUENCE, // consecutive frame out of order
+    CAN_ISOTP_WAIT,     // more flow control WAITs in a row than N_WFTmax
+};
+
+struct can_IsoTpConfig {
+    uint32_t rxId; // frames we receive: data from the peer, and flow control for our sends
+    uint32_t txId; // frames we send
+    bool extended;
+    uint8_t blockSize; // consecutive frames we accept per flow control, 0 for all
+    uint8_t stMin;     // separation time we ask the sender for, ISO-TP encoding
+};
+
+// Buffer for an announced message, or null to refuse it with an overflow
+typedef uint8_t* (*can_IsoTpBufferFn)(void* context, size_t channel, size_t size);
+typedef void (*can_IsoTpReceiveFn)(void* context, size_t channel, const uint8_t* data, size_t size);
+typedef void (*can_IsoTpResultFn)(void* context, size_t channel, can_IsoTpResult result);
+
+template <size_t Channels>
+class can_IsoTp {
+  public:
+    can_IsoTp(const can_TransmitFn transmit, void* txContext, const uint32_t ticksPerMs = 1) : transmit_(transmit), txContext_(txContext), ticksPerMs_(ticksPerMs) {}
+
+    // onSent reports the outcome of send(), onError failed receptions; buffer may be null
+    // when every channel has a fixed buffer
+    void setCallbacks(const can_IsoTpReceiveFn onReceive, const can_IsoTpResultFn onSent, const can_IsoTpResultFn onError, const can_IsoTpBufferFn buffer, void* context) {
+        onReceive_ = onReceive;
+        onSent_ = onSent;
+        onError_ = onError;
+        buffer_ = buffer;
+        context_ = context;
+    }
+
+    void setPadding(const uint8_t padding) { padding_ = padding; }
+
+    // Flow control WAITs accepted in a row before a send is given up (N_WFTmax)
+    void setMaxWaits(const uint8_t waits) { maxWaits_ = waits; }
+
+    // Returns the channel number, or -1 when full or the receive ID is taken
+    int addChannel(const can_IsoTpConfig& config, uint8_t* rxBuffer = nullptr, const size_t rxCapacity = 0) {
+        if (count_ >= Channels || find(config.rxId, config.extended) >= 0)
+            return -1;
+        Channel& c = channels_[count_];
+        c.config = config;
+        c.owner = this;
+        c.index = count_;
+        c.fixed = rxBuffer;
+        c.fixedCapacity = rxCapacity;
+        c.rxActive = false;
+        c.txState = TX_IDLE;
+        can_initTimer(c.rxTimer, &can_IsoTp::onRxTimeout, &c);
+        can_initTimer(c.txTimer, &can_IsoTp::onTxTimer, &c);
+
+        // Keep the lookup table sorted by receive ID
+        size_t j = count_;
+        const uint64_t key = keyOf(config.rxId, config.extended);
+        while (j > 0 && keyOf(channels_[order_[j - 1]].config.rxId, channels_[order_[j - 1]].config.extended) > key) {
+            order_[j] = order_[j - 1];
+            --j;
+        }
+        order_[j] = count_;
+        return static_cast<int>(count_++);
+    }
+
+    bool busy(const size_t channel) const { return channels_[channel].txState != TX_IDLE; }
+
+    // Starts sending; data is read in place and must stay valid until onSent.
+    // Returns false if the channel is still sending or the first frame could not be queued.
+    bool send(const size_t channel, const uint8_t* data, const size_t size) {
+        Channel& c = channels_[channel];
+        if (c.txState != TX_IDLE || size == 0)
+            return false;
+        uint8_t frame[8];
+        std::memset(frame, padding_, 8);
+        if (size <= 7) {
+            frame[0] = static_cast<uint8_t>(size);
+            std::memcpy(frame + 1, data, size);
+            if (!transmit_(txContext_, c.config.txId, c.config.extended, frame, 8))
+                return false;
+            if (onSent_)
+                onSent_(context_, channel, CAN_ISOTP_OK);
+            return true;
+        }
+
+        size_t first;
+        if (size <= 4095) {
+            frame[0] = static_cast<uint8_t>(0x10 | (size >> 8));
+            frame[1] = static_cast<uint8_t>(size);
+            first = 6;
+        } else {
+            frame[0] = 0x10;
+            frame[1] = 0x00;
+            frame[2] = static_cast<uint8_t>(size >> 24);
+            frame[3] = static_cast<uint8_t>(size >> 16);
+            frame[4] = static_cast<uint8_t>(size >> 8);
+            frame[5] = static_cast<uint8_t>(size);
+            first = 2;
+        }
+        std::memcpy(frame + 8 - first, data, first);
+        if (!transmit_(txContext_, c.config.txId, c.config.extended, frame, 8))
+            return false;
+        c.txData = data;
+        c.txSize = size;
+        c.txOffset = first;
+        c.txSeq = 1;
+        c.txWaits = 0;
+        c.txState = TX_WAIT_FC;
+        arm(c.txTimer, static_cast<uint64_t>(CAN_ISOTP_N_TIMEOUT) * ticksPerMs_);
+        return true;
+    }
+
+    // Returns false for frames not addressed to any channel
+    bool onFrame(const uint32_t id, const bool extended, const uint8_t (&data)[8], const uint8_t len, const uint64_t now) {
+        advance(now);
+        const int index = find(id, extended);
+        if (index < 0 || len == 0)
+            return index >= 0;
+        Channel& c = channels_[index];
+        switch (data[0] >> 4) {
+        case 0:
+            onSingle(c, data, len);
+            break;
+        case 1:
+            onFirst(c, data, len);
+            break;
+        case 2:
+            onConsecutive(c, data, len);
+            break;
+        case 3:
+            onFlowControl(c, data, len);
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    size_t advance(const uint64_t now) {
+        // Timers firing on earlier ticks set now_ to their own tick, so what they rearm keeps its pace
+        const size_t fired = wheel_.advance(now);
+        now_ = now;
+        return fired;
+    }
+
+  private:
+    enum TxState {
+        TX_IDLE,
+        TX_WAIT_FC,
+        TX_SENDING,
+    };
+
+    struct Channel {
+        can_IsoTpConfig config;
+        can_IsoTp* owner;
+        size_t index;
+        can_Timer rxTimer;
+        can_Timer txTimer;
+
+        uint8_t* fixed;
+        size_t fixedCapacity;
+        uint8_t* rxData;
+        size_t rxSize;
+        size_t rxOffset;
+        uint8_t rxSeq;
+        uint8_t rxBlockLeft;
+        bool rxActive;
+
+        const uint8_t* txData;
+        size_t txSize;
+        size_t txOffset;
+        uint8_t txSeq;
+        uint8_t txBlockSize;
+        uint8_t txBlockLeft;
+        uint8_t txWaits; // WAITs since the last clear to send
+        uint64_t txGap;
+        uint64_t txLast; // when the last consecutive frame went out
+        TxState txState;
+    };
+
+    static uint64_t keyOf(const uint32_t id, const bool extended) { return (static_cast<uint64_t>(extended) << 32) | id; }
+
+    int find(const uint32_t id, const bool extended) const {
+        const uint64_t key = keyOf(id, extended);
+        size_t lo = 0, hi = count_;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            const can_IsoTpConfig& cfg = channels_[order_[mid]].config;
+            const uint64_t k = keyOf(cfg.rxId, cfg.extended);
+            if (k == key)
+                return static_cast<int>(order_[mid]);
+            if (k < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return -1;
+    }
+
+    void arm(can_Timer& timer, const uint64_t ticks) { wheel_.schedule(timer, now_ + ticks); }
+
+    // STmin in ticks: 0-127 ms, or 100-900 us as 0xF1-0xF9; reserved values mean 127 ms.
+    // Microsecond values round up, so a coarse tick never turns them into no gap at all.
+    uint64_t gapOf(const uint8_t stMin) const {
+        if (stMin <= 0x7F)
+            return static_cast<uint64_t>(stMin) * ticksPerMs_;
+        if (stMin >= 0xF1 && stMin <= 0xF9)
+            return (static_cast<uint64_t>(stMin - 0xF0) * ticksPerMs_ + 9) / 10;
+        return static_cast<uint64_t>(0x7F) * ticksPerMs_;
+    }
+
+    void sendFlowControl(Channel& c, const uint8_t status) {
+        uint8_t frame[8];
+        std::memset(frame, padding_, 8);
+        frame[0] = static_cast<uint8_t>(0x30 | status);
+        frame[1] = c.config.blockSize;
+        frame[2] = c.config.stMin;
+        transmit_(txContext_, c.config.txId, c.config.extended, frame, 8);
+    }
+
+    void failRx(Channel& c, const can_IsoTpResult result) {
+        c.rxActive = false;
+        wheel_.cancel(c.rxTimer);
+        if (onError_)
+            onError_(context_, c.index, result);
+    }
+
+    void onSingle(Channel& c, const uint8_t (&data)[8], const uint8_t len) {
+        const size_t size = data[0] & 0x0F;
+        if (size == 0 || size + 1 > len)
+            return;
+        if (c.rxActive)
+            failRx(c, CAN_ISOTP_SEQUENCE); // a new message interrupts the current one
+        if (onReceive_)
+            onReceive_(context_, c.index, data + 1, size);
+    }
+
+    void onFirst(Channel& c, const uint8_t (&data)[8], const uint8_t len) {
+        if (len < 8)
+            return;
+        size_t size = ((data[0] & 0x0F) << 8) | data[1];
+        size_t first = 6;
+        if (size == 0) {
+            size = (static_cast<size_t>(data[2]) << 24) | (data[3] << 16) | (data[4] << 8) | data[5];
+            first = 2;
+        }
+        if (size <= 7)
+            return;
+        if (c.rxActive)
+            failRx(c, CAN_ISOTP_SEQUENCE);
+
+        uint8_t* buffer = nullptr;
+        if (c.fixed && size <= c.fixedCapacity)
+            buffer = c.fixed;
+        else if (!c.fixed && buffer_)
+            buffer = buffer_(context_, c.index, size);
+        if (!buffer) {
+            sendFlowControl(c, 2);
+            return;
+        }
+        c.rxData = buffer;
+        c.rxSize = size;
+        std::memcpy(buffer, data + 8 - first, first);
+        c.rxOffset = first;
+        c.rxSeq = 1;
+        c.rxBlockLeft = c.config.blockSize;
+        c.rxActive = true;
+        sendFlowControl(c, 0);
+        arm(c.rxTimer, static_cast<uint64_t>(CAN_ISOTP_N_TIMEOUT) * ticksPerMs_);
+    }
+
+    void onConsecutive(Channel& c, const uint8_t (&data)[8], const uint8_t len) {
+        if (!c.rxActive)
+            return;
+        if ((data[0] & 0x0F) != (c.rxSeq & 0x0F)) {
+            failRx(c, CAN_ISOTP_SEQUENCE);
+            return;
+        }
+        size_t n = c.rxSize - c.rxOffset < 7 ? c.rxSize - c.rxOffset : 7;
+        if (n + 1 > len) {
+            failRx(c, CAN_ISOTP_SEQUENCE);
+            return;
+        }
+        std::memcpy(c.rxData + c.rxOffset, data + 1, n);
+        c.rxOffset += n;
+        ++c.rxSeq;
+
+        if (c.rxOffset == c.rxSize) {
+            c.rxActive = false;
+            wheel_.cancel(c.rxTimer);
+            if (onReceive_)
+                onReceive_(context_, c.index, c.rxData, c.rxSize);
+            return;
+        }
+        if (c.config.blockSize && --c.rxBlockLeft == 0) {
+            c.rxBlockLeft = c.config.blockSize;
+            sendFlowControl(c, 0);
+        }
+        arm(c.rxTimer, static_cast<uint64_t>(CAN_ISOTP_N_TIMEOUT) * ticksPerMs_);
+    }
+
+    void onFlowControl(Channel& c, const uint8_t (&data)[8], const uint8_t len) {
+        if (c.txState != TX_WAIT_FC || len < 3)
+            return;
+        switch (data[0] & 0x0F) {
+        case 0:
+            c.txWaits = 0;
+            c.txBlockSize = data[1];
+            c.txBlockLeft = data[1];
+            c.txGap = gapOf(data[2]);
+            c.txState = TX_SENDING;
+            if (c.txGap && c.txSeq > 1 && now_ < c.txLast + c.txGap)
+                arm(c.txTimer, c.txLast + c.txGap - now_); // STmin also spans the flow control
+            else
+                sendConsecutive(c);
+            break;
+        case 1:
+            if (++c.txWaits > maxWaits_)
+                finishTx(c, CAN_ISOTP_WAIT);
+            else
+                arm(c.txTimer, static_cast<uint64_t>(CAN_ISOTP_N_TIMEOUT) * ticksPerMs_);
+            break;
+        case 2:
+            finishTx(c, CAN_ISOTP_OVERFLOW);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Send consecutive frames until the block ends, STmin requires a pause or the driver is full
+    void sendConsecutive(Channel& c) {
+        for (;;) {
+            uint8_t frame[8];
+            std::memset(frame, padding_, 8);
+            frame[0] = static_cast<uint8_t>(0x20 | (c.txSeq & 0x0F));
+            const size_t n = c.txSize - c.txOffset < 7 ? c.txSize - c.txOffset : 7;
+            std::memcpy(frame + 1, c.txData + c.txOffset, n);
+            if (!transmit_(txContext_, c.config.txId, c.config.extended, frame, 8)) {
+                arm(c.txTimer, 1); // retry on the next tick
+                return;
+            }
+            c.txOffset += n;
+            c.txLast = now_;
+            ++c.txSeq;
+            if (c.txOffset == c.txSize) {
+                finishTx(c, CAN_ISOTP_OK);
+                return;
+            }
+            if (c.txBlockSize && --c.txBlockLeft == 0) {
+                c.txState = TX_WAIT_FC;
+                arm(c.txTimer, static_cast<uint64_t>(CAN_ISOTP_N_TIMEOUT) * ticksPerMs_);
+                return;
+            }
+            if (c.txGap) {
+                arm(c.txTimer, c.txGap);
+                return;
+            }
+        }
+    }
+
+    void finishTx(Channel& c, const can_IsoTpResult result) {
+        c.txState = TX_IDLE;
+        wheel_.cancel(c.txTimer);
+        if (onSent_)
+            onSent_(context_, c.index, result);
+    }
+
+    static void onRxTimeout(void* context, can_Timer&, const uint64_t now) {
+        Channel& c = *static_cast<Channel*>(context);
+        c.owner->now_ = now;
+        c.owner->failRx(c, CAN_ISOTP_TIMEOUT);
+    }
+
+    static void onTxTimer(void* context, can_Timer&, const uint64_t now) {
+        Channel& c = *static_cast<Channel*>(context);
+        c.owner->now_ = now;
+        if (c.txState == TX_WAIT_FC)
+            c.owner->finishTx(c, CAN_ISOTP_TIMEOUT);
+        else if (c.txState == TX_SENDING)
+            c.owner->sendConsecutive(c);
+    }
+
+    Channel channels_[Channels];
+    size_t order_[Channels]; // channel numbers sorted by receive ID
+    size_t count_ = 0;
+    can_TimerWheel<> wheel_;
+    uint64_t now_ = 0;
+    uint8_t padding_ = 0xCC;
+    uint8_t maxWaits_ = CAN_ISOTP_WFT_MAX;
+    can_TransmitFn transmit_;
+    void* txContext_;
+    uint32_t ticksPerMs_;
+    can_IsoTpReceiveFn onReceive_ = nullptr;
+    can_IsoTpResultFn onSent_ = nullptr;
+    can_IsoTpResultFn onError_ = nullptr;
+    can_IsoTpBufferFn buffer_ = nullptr;
+    void* context_ = nullptr;
+};
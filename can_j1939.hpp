@@ -0,0 +1,233 @@
+#pragma once
+
+// SAE J1939 identifiers and PGN/SPN decoding.
+// A 29-bit J1939 identifier carries a 3-bit priority, the parameter group
+// number (PGN) and the sender's source address; PDU1 groups (PF < 240) also
+// carry a destination address in the PDU specific byte. Signals (SPNs) are
+// looked up by PGN, so priority and addresses never take part in matching.
+// No heap.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+static const uint8_t CAN_J1939_GLOBAL = 0xFF;   // destination "all nodes"
+static const uint8_t CAN_J1939_NULL_ADDR = 0xFE; // source of nodes without an address
+
+struct can_J1939Id {
+    uint32_t pgn; // 18 bits, PDU specific byte cleared for PDU1 groups
+    uint8_t priority;
+    uint8_t source;
+    uint8_t destination; // CAN_J1939_GLOBAL for PDU2 groups
+};
+
+inline can_J1939Id can_parseJ1939Id(const uint32_t id) {
+    can_J1939Id out;
+    const uint8_t pf = static_cast<uint8_t>(id >> 16);
+    const uint8_t ps = static_cast<uint8_t>(id >> 8);
+    out.priority = static_cast<uint8_t>((id >> 26) & 0x7);
+    out.source = static_cast<uint8_t>(id);
+    if (pf < 240) {
+        out.pgn = (id >> 8) & 0x3FF00;
+        out.destination = ps;
+    } else {
+        out.pgn = (id >> 8) & 0x3FFFF;
+        out.destination = CAN_J1939_GLOBAL;
+    }
+    return out;
+}
+
+// The destination is ignored for PDU2 groups
+inline uint32_t can_makeJ1939Id(const uint8_t priority, const uint32_t pgn, const uint8_t source, const uint8_t destination = CAN_J1939_GLOBAL) {
+    uint32_t id = (static_cast<uint32_t>(priority & 0x7) << 26) | ((pgn & 0x3FFFF) << 8) | source;
+    if (((pgn >> 8) & 0xFF) < 240)
+        id = (id & ~0xFF00u) | (static_cast<uint32_t>(destination) << 8);
+    return id;
+}
+
+// J1939-71 ranges at the top of every parameter's raw domain
+enum can_SpnStatus : uint8_t {
+    CAN_SPN_VALID,
+    CAN_SPN_RESERVED,
+    CAN_SPN_ERROR,
+    CAN_SPN_NOT_AVAILABLE,
+};
+
+// For parameters of a byte or more the most significant byte decides: 0xFF not
+// available, 0xFE error, 0xFB-0xFD reserved. Shorter ones use all ones for not
+// available and all ones minus one for error.
+inline can_SpnStatus can_spnStatus(const uint64_t raw, const size_t length) {
+    if (length >= 8) {
+        const uint8_t top = static_cast<uint8_t>(raw >> (length - 8));
+        if (top == 0xFF)
+            return CAN_SPN_NOT_AVAILABLE;
+        if (top == 0xFE)
+            return CAN_SPN_ERROR;
+        return top > 0xFA ? CAN_SPN_RESERVED : CAN_SPN_VALID;
+    }
+    const uint64_t ones = (1ULL << length) - 1ULL;
+    if (length > 1 && raw == ones)
+        return CAN_SPN_NOT_AVAILABLE;
+    if (length > 1 && raw == ones - 1)
+        return CAN_SPN_ERROR;
+    return CAN_SPN_VALID;
+}
+
+struct can_J1939Spn {
+    uint32_t spn;
+    uint32_t pgn;
+    can_Signal signal; // Intel byte order within the PGN's data field
+};
+
+// Smallest power of two holding count entries at most half full
+constexpr size_t can_hashSlots(const size_t count, const size_t slots = 1) {
+    return slots >= 2 * count ? slots : can_hashSlots(count, slots * 2);
+}
+
+// PGN and SPN lookups are open-addressed hash tables sized to twice the capacity,
+// so both are constant time on average.
+template <size_t Messages, size_t Spns>
+class can_J1939Database {
+    static_assert(Messages < 0xFFFF && Spns < 0xFFFF, "indices are stored in 16 bits");
+
+  public:
+    can_J1939Database() {
+        for (size_t i = 0; i < PGN_SLOTS; ++i)
+            pgnSlots_[i] = NONE;
+        for (size_t i = 0; i < SPN_SLOTS; ++i)
+            spnSlots_[i] = NONE;
+    }
+
+    // Returns the SPN number in the database, or -1 when full or already present
+    int add(const can_J1939Spn& spn) {
+        if (spnCount_ >= Spns || findSpn(spn.spn) >= 0)
+            return -1;
+        int message = findPgn(spn.pgn);
+        if (message < 0) {
+            if (messageCount_ >= Messages)
+                return -1;
+            message = static_cast<int>(messageCount_++);
+            messages_[message].pgn = spn.pgn;
+            messages_[message].first = NONE;
+            messages_[message].count = 0;
+            pgnSlots_[probe(pgnSlots_, PGN_SLOTS, spn.pgn, true)] = static_cast<uint16_t>(message);
+        }
+
+        const size_t index = spnCount_++;
+        spns_[index].def = spn;
+        spns_[index].next = NONE;
+        spns_[index].message = static_cast<uint16_t>(message);
+        // Keep the SPNs of a message in the order they were added
+        Message& m = messages_[message];
+        if (m.first == NONE) {
+            m.first = static_cast<uint16_t>(index);
+        } else {
+            size_t last = m.first;
+            while (spns_[last].next != NONE)
+                last = spns_[last].next;
+            spns_[last].next = static_cast<uint16_t>(index);
+        }
+        ++m.count;
+        spnSlots_[probe(spnSlots_, SPN_SLOTS, spn.spn, false)] = static_cast<uint16_t>(index);
+        return static_cast<int>(index);
+    }
+
+    size_t messageCount() const { return messageCount_; }
+    size_t spnCount() const { return spnCount_; }
+    const can_J1939Spn& spn(const size_t index) const { return spns_[index].def; }
+
+    // Message index for a PGN, or -1
+    int findPgn(const uint32_t pgn) const {
+        const size_t slot = probe(pgnSlots_, PGN_SLOTS, pgn, true);
+        return pgnSlots_[slot] == NONE ? -1 : static_cast<int>(pgnSlots_[slot]);
+    }
+
+    // Message index for a received 29-bit identifier, whatever its priority and addresses
+    int findId(const uint32_t id) const { return findPgn(can_parseJ1939Id(id).pgn); }
+
+    // SPN index in the database, or -1
+    int findSpn(const uint32_t spn) const {
+        const size_t slot = probe(spnSlots_, SPN_SLOTS, spn, false);
+        return spnSlots_[slot] == NONE ? -1 : static_cast<int>(spnSlots_[slot]);
+    }
+
+    // Decode every SPN of the frame's PGN in the order they were added; returns how many,
+    // or 0 if the PGN is unknown. status may be null.
+    size_t decode(const uint32_t id, const uint8_t (&buf)[8], float* values, can_SpnStatus* status) const {
+        const int message = findId(id);
+        if (message < 0)
+            return 0;
+        size_t n = 0;
+        for (size_t i = messages_[message].first; i != NONE; i = spns_[i].next, ++n)
+            values[n] = decodeOne(buf, spns_[i].def.signal, status ? &status[n] : nullptr);
+        return n;
+    }
+
+    // Pull one SPN out of a batch of frames, skipping frames of other PGNs or, if source
+    // is not negative, other senders. Returns the number of values written; status and
+    // timestamps may be null.
+    size_t decodeBatch(const can_Frame* frames, const size_t count, const uint32_t spn, float* values, can_SpnStatus* status, uint64_t* timestamps, const int source = -1) const {
+        const int index = findSpn(spn);
+        if (index < 0)
+            return 0;
+        const can_J1939Spn& def = spns_[index].def;
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const can_Frame& f = frames[i];
+            if (!(f.flags & CAN_FRAME_EXTENDED))
+                continue;
+            const can_J1939Id id = can_parseJ1939Id(f.id);
+            if (id.pgn != def.pgn || (source >= 0 && id.source != source))
+                continue;
+            values[n] = decodeOne(can_frameData(f), def.signal, status ? &status[n] : nullptr);
+            if (timestamps)
+                timestamps[n] = f.timestamp;
+            ++n;
+        }
+        return n;
+    }
+
+  private:
+    static const uint16_t NONE = 0xFFFF;
+
+    static const size_t PGN_SLOTS = can_hashSlots(Messages);
+    static const size_t SPN_SLOTS = can_hashSlots(Spns);
+
+    struct Message {
+        uint32_t pgn;
+        uint16_t first;
+        uint16_t count;
+    };
+
+    struct Entry {
+        can_J1939Spn def;
+        uint16_t next;
+        uint16_t message;
+    };
+
+    static float decodeOne(const uint8_t (&buf)[8], const can_Signal& sig, can_SpnStatus* status) {
+        const uint64_t raw = can_getSignal<uint64_t>(buf, sig.startBit, sig.length, sig.isIntel);
+        if (status)
+            *status = can_spnStatus(raw, sig.length);
+        const int64_t value = sig.isSigned ? can_signExtend(raw, sig.length) : static_cast<int64_t>(raw);
+        return (value * sig.factor) + sig.offset;
+    }
+
+    // Linear probing; returns the key's slot or the empty slot where it would go
+    size_t probe(const uint16_t* table, const size_t slots, const uint32_t key, const bool pgn) const {
+        size_t slot = (key * 2654435761u) & (slots - 1);
+        while (table[slot] != NONE && keyAt(table[slot], pgn) != key)
+            slot = (slot + 1) & (slots - 1);
+        return slot;
+    }
+
+    uint32_t keyAt(const uint16_t index, const bool pgn) const { return pgn ? messages_[index].pgn : spns_[index].def.spn; }
+
+    Message messages_[Messages];
+    Entry spns_[Spns];
+    uint16_t pgnSlots_[PGN_SLOTS];
+    uint16_t spnSlots_[SPN_SLOTS];
+    size_t messageCount_ = 0;
+    size_t spnCount_ = 0;
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+// J1939 transport protocol (J1939-21) reassembly for multi-packet messages of
+// up to 1785 bytes, both broadcast (BAM) and connection mode (RTS/CTS).
+// Sessions live in a fixed pool and are found in constant time by source
+// address, with connections from one source to several destinations chained
+// behind it; every frame costs one table lookup and one 7-byte copy. Timeouts run
+// on a timing wheel driven by the caller's clock. Completed payloads are handed
+// to a callback and can be decoded with the length-generic can_getSignal.
+// Connection mode transfers addressed to our own address are answered with
+// CTS / EndOfMsgAck through a transmit callback; all others are followed
+// passively, which suits loggers. No heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+#include "can_j1939.hpp"
+#include "can_timer.hpp"
+
+static const uint32_t CAN_J1939_PGN_TP_CM = 0xEC00;
+static const uint32_t CAN_J1939_PGN_TP_DT = 0xEB00;
+static const size_t CAN_J1939_TP_MAX = 1785; // 255 packets of 7 bytes
+
+enum can_J1939TpControl : uint8_t {
+    CAN_TP_RTS = 16,
+    CAN_TP_CTS = 17,
+    CAN_TP_EOMA = 19,
+    CAN_TP_BAM = 32,
+    CAN_TP_ABORT = 255,
+};
+
+enum can_J1939TpAbortReason : uint8_t {
+    CAN_TP_ABORT_BUSY = 1,
+    CAN_TP_ABORT_RESOURCES = 2,
+    CAN_TP_ABORT_TIMEOUT = 3,
+    CAN_TP_ABORT_SEQUENCE = 7,
+};
+
+// T1 between data packets, T2 after a CTS, in milliseconds (J1939-21)
+static const uint32_t CAN_J1939_TP_T1 = 750;
+static const uint32_t CAN_J1939_TP_T2 = 1250;
+
+typedef void (*can_J1939MessageFn)(void* context, uint32_t pgn, uint8_t source, uint8_t destination, const uint8_t* data, size_t size, uint64_t now);
+
+template <size_t Sessions, size_t MaxSize = CAN_J1939_TP_MAX>
+class can_J1939Reassembler {
+    static_assert(Sessions > 0 && Sessions < 256, "session indices are stored in a byte");
+
+  public:
+    // ticksPerMs converts the protocol timeouts into the clock passed to onFrame/advance
+    can_J1939Reassembler(const uint8_t address, const can_J1939MessageFn onMessage, void* context, const can_TransmitFn transmit = nullptr, void* txContext = nullptr, const uint32_t ticksPerMs = 1)
+        : address_(address), onMessage_(onMessage), context_(context), transmit_(transmit), txContext_(txContext), ticksPerMs_(ticksPerMs) {
+        std::memset(index_, 0, sizeof(index_));
+        for (size_t i = 0; i < Sessions; ++i) {
+            sessions_[i].owner = this;
+            can_initTimer(sessions_[i].timer, &can_J1939Reassembler::onTimeout, &sessions_[i]);
+            free_[i] = static_cast<uint8_t>(Sessions - 1 - i);
+        }
+        freeCount_ = Sessions;
+    }
+
+    // Packets we ask for per CTS when we are the receiver
+    void setWindow(const uint8_t packets) { window_ = packets ? packets : 1; }
+
+    size_t active() const { return Sessions - freeCount_; }
+
+    // Returns false for frames that are not TP.CM / TP.DT
+    bool onFrame(const uint32_t id, const uint8_t (&data)[8], const uint8_t len, const uint64_t now) {
+        advance(now);
+        const can_J1939Id j = can_parseJ1939Id(id);
+        if (j.pgn == CAN_J1939_PGN_TP_DT) {
+            if (len == 8)
+                onData(j, data);
+            return true;
+        }
+        if (j.pgn == CAN_J1939_PGN_TP_CM) {
+            if (len == 8)
+                onControl(j, data);
+            return true;
+        }
+        return false;
+    }
+
+    // Expire stalled sessions; returns the number dropped
+    size_t advance(const uint64_t now) {
+        now_ = now;
+        return wheel_.advance(now);
+    }
+
+  private:
+    enum Kind {
+        BROADCAST,
+        CONNECTION,
+    };
+
+    struct Session {
+        can_J1939Reassembler* owner;
+        can_Timer timer;
+        uint32_t pgn;
+        uint16_t size;
+        uint8_t packets;
+        uint8_t next;      // next expected sequence number
+        uint8_t windowEnd; // last sequence number of the current CTS window
+        uint8_t senderMax; // packets per CTS the sender accepts
+        uint8_t source;
+        uint8_t destination;
+        uint8_t kind;
+        uint8_t link; // slot + 1 of the next session from the same source, 0 if none
+        bool responder;
+        uint8_t data[MaxSize];
+    };
+
+    // Connection mode transfers are keyed by source and destination; broadcasts all go to the global address
+    Session* find(const Kind kind, const uint8_t source, const uint8_t destination) {
+        for (uint8_t slot = index_[kind][source]; slot; slot = sessions_[slot - 1].link) {
+            if (sessions_[slot - 1].destination == destination)
+                return &sessions_[slot - 1];
+        }
+        return nullptr;
+    }
+
+    Session* open(const Kind kind, const can_J1939Id& j, const uint8_t (&data)[8]) {
+        Session* s = find(kind, j.source, j.destination);
+        if (s)
+            release(*s); // a new announcement replaces an unfinished transfer
+        if (freeCount_ == 0)
+            return nullptr;
+        const uint8_t slot = free_[--freeCount_];
+        s = &sessions_[slot];
+        s->link = index_[kind][j.source];
+        index_[kind][j.source] = static_cast<uint8_t>(slot + 1);
+        s->kind = static_cast<uint8_t>(kind);
+        s->source = j.source;
+        s->destination = j.destination;
+        s->size = static_cast<uint16_t>(data[1] | (data[2] << 8));
+        s->packets = data[3];
+        s->pgn = pgnOf(data);
+        s->next = 1;
+        s->windowEnd = s->packets;
+        s->senderMax = 0xFF;
+        s->responder = false;
+        return s;
+    }
+
+    void release(Session& s) {
+        wheel_.cancel(s.timer);
+        const uint8_t slot = static_cast<uint8_t>(&s - sessions_);
+        uint8_t* link = &index_[s.kind][s.source];
+        while (*link != slot + 1)
+            link = &sessions_[*link - 1].link;
+        *link = s.link;
+        free_[freeCount_++] = slot;
+    }
+
+    void arm(Session& s, const uint32_t ms) { wheel_.schedule(s.timer, now_ + static_cast<uint64_t>(ms) * ticksPerMs_); }
+
+    static bool valid(const uint8_t (&data)[8]) {
+        const size_t size = data[1] | (data[2] << 8);
+        return size > 8 && size <= MaxSize && data[3] == (size + 6) / 7;
+    }
+
+    void onControl(const can_J1939Id& j, const uint8_t (&data)[8]) {
+        switch (data[0]) {
+        case CAN_TP_BAM: {
+            if (j.destination != CAN_J1939_GLOBAL || !valid(data))
+                return;
+            Session* s = open(BROADCAST, j, data);
+            if (s)
+                arm(*s, CAN_J1939_TP_T1);
+            return;
+        }
+        case CAN_TP_RTS: {
+            if (j.destination == CAN_J1939_GLOBAL)
+                return;
+            const bool ours = j.destination == address_ && transmit_;
+            if (!ours && address_ != CAN_J1939_NULL_ADDR)
+                return; // someone else's transfer, and we only follow our own
+            Session* s = valid(data) ? open(CONNECTION, j, data) : nullptr;
+            if (!s) {
+                if (ours)
+                    sendControl(j.source, CAN_TP_ABORT, CAN_TP_ABORT_RESOURCES, 0xFF, 0xFF, pgnOf(data));
+                return;
+            }
+            s->responder = ours;
+            s->senderMax = data[4] ? data[4] : 0xFF; // 0 is taken as no limit, like 0xFF
+            if (ours)
+                requestWindow(*s);
+            arm(*s, CAN_J1939_TP_T2);
+            return;
+        }
+        case CAN_TP_CTS: {
+            // Seen passively: the receiver (our source) grants packets to the sender
+            Session* s = find(CONNECTION, j.destination, j.source);
+            if (s && !s->responder && data[1] != 0 && data[2] != 0 && data[2] <= s->packets) {
+                s->next = data[2];
+                arm(*s, CAN_J1939_TP_T2);
+            }
+            return;
+        }
+        case CAN_TP_ABORT: {
+            Session* s = find(CONNECTION, j.source, j.destination);
+            if (s)
+                release(*s);
+            s = find(CONNECTION, j.destination, j.source);
+            if (s)
+                release(*s);
+            return;
+        }
+        default:
+            return;
+        }
+    }
+
+    void onData(const can_J1939Id& j, const uint8_t (&data)[8]) {
+        Session* s = find(j.destination == CAN_J1939_GLOBAL ? BROADCAST : CONNECTION, j.source, j.destination);
+        if (!s)
+            return;
+        const uint8_t seq = data[0];
+        if (seq != s->next || seq == 0 || seq > s->packets) {
+            if (!s->responder && seq != 0 && seq < s->next)
+                return; // retransmission already seen
+            if (s->responder)
+                sendControl(s->source, CAN_TP_ABORT, CAN_TP_ABORT_SEQUENCE, 0xFF, 0xFF, s->pgn);
+            release(*s);
+            return;
+        }
+
+        const size_t offset = static_cast<size_t>(seq - 1) * 7;
+        std::memcpy(s->data + offset, data + 1, s->size - offset < 7 ? s->size - offset : 7);
+        ++s->next;
+
+        if (seq == s->packets) {
+            if (s->responder)
+                sendControl(s->source, CAN_TP_EOMA, static_cast<uint8_t>(s->size), static_cast<uint8_t>(s->size >> 8), s->packets, s->pgn);
+            onMessage_(context_, s->pgn, s->source, s->destination, s->data, s->size, now_);
+            release(*s);
+        } else if (s->responder && seq == s->windowEnd) {
+            requestWindow(*s);
+            arm(*s, CAN_J1939_TP_T2);
+        } else {
+            arm(*s, CAN_J1939_TP_T1);
+        }
+    }
+
+    void requestWindow(Session& s) {
+        uint8_t count = static_cast<uint8_t>(s.packets - s.next + 1);
+        if (count > window_)
+            count = window_;
+        if (count > s.senderMax)
+            count = s.senderMax;
+        s.windowEnd = static_cast<uint8_t>(s.next + count - 1);
+        sendControl(s.source, CAN_TP_CTS, count, s.next, 0xFF, s.pgn);
+    }
+
+    void sendControl(const uint8_t destination, const uint8_t control, const uint8_t b1, const uint8_t b2, const uint8_t b3, const uint32_t pgn) {
+        if (!transmit_)
+            return;
+        const uint8_t data[8] = {control, b1, b2, b3, 0xFF, static_cast<uint8_t>(pgn), static_cast<uint8_t>(pgn >> 8), static_cast<uint8_t>(pgn >> 16)};
+        transmit_(txContext_, can_makeJ1939Id(7, CAN_J1939_PGN_TP_CM, address_, destination), true, data, 8);
+    }
+
+    static uint32_t pgnOf(const uint8_t (&data)[8]) { return data[5] | (data[6] << 8) | (static_cast<uint32_t>(data[7]) << 16); }
+
+    static void onTimeout(void* context, can_Timer&, uint64_t) {
+        Session& s = *static_cast<Session*>(context);
+        if (s.responder)
+            s.owner->sendControl(s.source, CAN_TP_ABORT, CAN_TP_ABORT_TIMEOUT, 0xFF, 0xFF, s.pgn);
+        s.owner->release(s);
+    }
+
+    Session sessions_[Sessions];
+    uint8_t index_[2][256]; // first session slot + 1 per kind and source address, 0 if none
+    uint8_t free_[Sessions];
+    size_t freeCount_;
+    can_TimerWheel<> wheel_;
+    uint64_t now_ = 0;
+    uint8_t address_;
+    uint8_t window_ = 16;
+    can_J1939MessageFn onMessage_;
+    void* context_;
+    can_TransmitFn transmit_;
+    void* txContext_;
+    uint32_t ticksPerMs_;
+};
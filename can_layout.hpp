@@ -0,0 +1,137 @@
+#pragma once
+
+// Compile-time signal layouts.
+// A message's fields are listed as template arguments. Fields that directly
+// follow each other in the same byte order form a run: the run is extracted
+// with one shift and mask, and its fields are then split off in registers by
+// shifting the run down, instead of one can_getSignal per field. The payload
+// is loaded (and byte-swapped, if any field is Motorola) exactly once.
+// List fields in bit order so neighbours can merge. No heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+constexpr uint64_t can_lengthMask(const size_t length) {
+    return length < 64 ? (1ULL << length) - 1ULL : -1ULL;
+}
+
+// Same bit numbering as can_getSignal
+template <uint16_t StartBit, uint8_t Length, bool IsIntel, bool IsSigned = false>
+struct can_Field {
+    static constexpr size_t shift = IsIntel ? StartBit : (56 - StartBit + (2 * (StartBit % 8)));
+    static constexpr size_t length = Length;
+    static constexpr bool isIntel = IsIntel;
+    static constexpr bool isSigned = IsSigned;
+};
+
+template <typename F, typename G>
+struct can_FieldsAdjacent {
+    static constexpr bool value = F::isIntel == G::isIntel && G::shift == F::shift + F::length;
+};
+
+// Bits covered by the run that starts at the first field
+template <typename... Fields>
+struct can_RunLength;
+
+template <typename F>
+struct can_RunLength<F> {
+    static constexpr size_t value = F::length;
+};
+
+template <typename F, typename G, typename... Rest>
+struct can_RunLength<F, G, Rest...> {
+    static constexpr size_t value = F::length + (can_FieldsAdjacent<F, G>::value ? can_RunLength<G, Rest...>::value : 0);
+};
+
+template <typename... Fields>
+struct can_RunCount;
+
+template <>
+struct can_RunCount<> {
+    static constexpr size_t value = 0;
+};
+
+template <typename F>
+struct can_RunCount<F> {
+    static constexpr size_t value = 1;
+};
+
+template <typename F, typename G, typename... Rest>
+struct can_RunCount<F, G, Rest...> {
+    static constexpr size_t value = can_RunCount<G, Rest...>::value + (can_FieldsAdjacent<F, G>::value ? 0 : 1);
+};
+
+template <typename... Fields>
+struct can_AnyMotorola;
+
+template <>
+struct can_AnyMotorola<> {
+    static constexpr bool value = false;
+};
+
+template <typename F, typename... Rest>
+struct can_AnyMotorola<F, Rest...> {
+    static constexpr bool value = !F::isIntel || can_AnyMotorola<Rest...>::value;
+};
+
+template <size_t Index, bool NewRun, typename... Fields>
+struct can_LayoutDecoder;
+
+template <size_t Index, bool NewRun>
+struct can_LayoutDecoder<Index, NewRun> {
+    static void decode(uint64_t, uint64_t, uint64_t, int64_t*) {}
+};
+
+template <size_t Index, bool NewRun, typename F, typename... Rest>
+struct can_LayoutDecoder<Index, NewRun, F, Rest...> {
+    template <typename... Next>
+    struct Follows {
+        static constexpr bool value = false;
+    };
+
+    template <typename G, typename... Next>
+    struct Follows<G, Next...> {
+        static constexpr bool value = can_FieldsAdjacent<F, G>::value;
+    };
+
+    static void decode(const uint64_t intel, const uint64_t motorola, uint64_t run, int64_t* out) {
+        if (NewRun)
+            run = ((F::isIntel ? intel : motorola) >> F::shift) & can_lengthMask(can_RunLength<F, Rest...>::value);
+        const uint64_t raw = run & can_lengthMask(F::length);
+        out[Index] = F::isSigned ? can_signExtend(raw, F::length) : static_cast<int64_t>(raw);
+        can_LayoutDecoder<Index + 1, !Follows<Rest...>::value, Rest...>::decode(intel, motorola, F::length < 64 ? run >> (F::length % 64) : 0, out);
+    }
+};
+
+template <typename... Fields>
+struct can_Layout {
+    static constexpr size_t size = sizeof...(Fields);
+    static constexpr size_t runs = can_RunCount<Fields...>::value;
+
+    // Raw values of every field, in declaration order
+    static void decode(const uint8_t (&buf)[8], int64_t (&out)[sizeof...(Fields)]) {
+        uint64_t word;
+        std::memcpy(&word, buf, 8);
+        const uint64_t motorola = can_AnyMotorola<Fields...>::value ? __builtin_bswap64(word) : 0;
+        can_LayoutDecoder<0, true, Fields...>::decode(word, motorola, 0, out);
+    }
+
+    // One column per field
+    static void decodeBatch(const can_Frame* frames, const size_t count, int64_t* const (&columns)[sizeof...(Fields)]) {
+        for (size_t i = 0; i < count; ++i) {
+            int64_t raw[sizeof...(Fields)];
+            decode(can_frameData(frames[i]), raw);
+            for (size_t f = 0; f < sizeof...(Fields); ++f)
+                columns[f][i] = raw[f];
+        }
+    }
+};
+
+template <typename... Fields>
+constexpr size_t can_Layout<Fields...>::size;
+
+template <typename... Fields>
+constexpr size_t can_Layout<Fields...>::runs;
@@ -0,0 +1,165 @@
+#pragma once
+
+// Streaming k-way merge of per-bus frame streams into one time-ordered stream.
+// A loser tree picks the next source in log2(k) comparisons, and a small
+// reorder buffer per source absorbs timestamp disorder up to a configurable
+// window. Memory is bounded by the frames inside the window plus one batch
+// per source. Host-side only.
+
+#include <queue>
+#include <stdint.h>
+#include <vector>
+
+#include "can_pcap.hpp"
+
+class can_FrameSource {
+  public:
+    virtual ~can_FrameSource() {}
+
+    // Fill up to maxFrames frames; returns 0 once the stream is exhausted
+    virtual size_t read(can_Frame* frames, size_t maxFrames) = 0;
+};
+
+class can_ArraySource : public can_FrameSource {
+  public:
+    can_ArraySource(const can_Frame* frames, const size_t count) : frames_(frames), count_(count) {}
+
+    size_t read(can_Frame* frames, const size_t maxFrames) {
+        size_t n = 0;
+        while (n < maxFrames && pos_ < count_)
+            frames[n++] = frames_[pos_++];
+        return n;
+    }
+
+  private:
+    const can_Frame* frames_;
+    size_t count_;
+    size_t pos_ = 0;
+};
+
+// Reads a capture; a non-negative bus overrides can_Frame::bus, e.g. one file per bus
+class can_PcapSource : public can_FrameSource {
+  public:
+    explicit can_PcapSource(can_PcapReader& reader, const int bus = -1) : reader_(reader), bus_(bus) {}
+
+    size_t read(can_Frame* frames, const size_t maxFrames) {
+        const size_t n = reader_.readBatch(frames, maxFrames);
+        if (bus_ >= 0) {
+            for (size_t i = 0; i < n; ++i)
+                frames[i].bus = static_cast<uint8_t>(bus_);
+        }
+        return n;
+    }
+
+  private:
+    can_PcapReader& reader_;
+    int bus_;
+};
+
+class can_MergeStage {
+  public:
+    // Frames may arrive up to reorderWindow microseconds late within their own source.
+    // Later stragglers are passed on as soon as they are seen.
+    explicit can_MergeStage(const uint64_t reorderWindow = 0, const size_t batchSize = 64)
+        : window_(reorderWindow), batchSize_(batchSize ? batchSize : 1) {}
+
+    // Sources must outlive the stage and be added before the first read()
+    void addSource(can_FrameSource* source) {
+        Input input;
+        input.source = source;
+        inputs_.push_back(input);
+        started_ = false;
+    }
+
+    // Time-ordered output, ready for can_getSignalBatch; returns 0 once every source is exhausted
+    size_t read(can_Frame* out, const size_t maxFrames) {
+        if (!started_)
+            start();
+        size_t n = 0;
+        while (n < maxFrames && !inputs_.empty()) {
+            const int w = tree_[0];
+            Input& input = inputs_[w];
+            if (input.pending.empty())
+                break;
+            out[n++] = input.pending.top();
+            input.pending.pop();
+            refill(input);
+            adjust(w);
+        }
+        return n;
+    }
+
+  private:
+    struct Later {
+        bool operator()(const can_Frame& a, const can_Frame& b) const { return a.timestamp > b.timestamp; }
+    };
+
+    struct Input {
+        can_FrameSource* source;
+        std::priority_queue<can_Frame, std::vector<can_Frame>, Later> pending;
+        uint64_t latest = 0;
+        bool exhausted = false;
+    };
+
+    // Pull from the source until its earliest frame can no longer be overtaken
+    void refill(Input& input) {
+        while (!input.exhausted && (input.pending.empty() || input.latest < input.pending.top().timestamp + window_)) {
+            batch_.resize(batchSize_);
+            const size_t n = input.source->read(batch_.data(), batchSize_);
+            if (n == 0) {
+                input.exhausted = true;
+                break;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (batch_[i].timestamp > input.latest)
+                    input.latest = batch_[i].timestamp;
+                input.pending.push(batch_[i]);
+            }
+        }
+    }
+
+    // Ties go to the lower source index so the merge is deterministic
+    bool before(const int a, const int b) const {
+        const int k = static_cast<int>(inputs_.size());
+        if (a == k || b == k)
+            return a == k; // build sentinel beats everything
+        const bool aEmpty = inputs_[a].pending.empty();
+        const bool bEmpty = inputs_[b].pending.empty();
+        if (aEmpty || bEmpty)
+            return !aEmpty || (bEmpty && a < b);
+        const uint64_t ta = inputs_[a].pending.top().timestamp;
+        const uint64_t tb = inputs_[b].pending.top().timestamp;
+        return ta < tb || (ta == tb && a < b);
+    }
+
+    // Replay the matches from a leaf to the root, leaving losers in the internal nodes
+    void adjust(int leaf) {
+        const int k = static_cast<int>(inputs_.size());
+        int winner = leaf;
+        for (int node = (leaf + k) / 2; node > 0; node /= 2) {
+            if (before(tree_[node], winner)) {
+                const int loser = winner;
+                winner = tree_[node];
+                tree_[node] = loser;
+            }
+        }
+        tree_[0] = winner;
+    }
+
+    void start() {
+        const int k = static_cast<int>(inputs_.size());
+        for (int i = 0; i < k; ++i)
+            refill(inputs_[i]);
+        tree_.assign(k > 0 ? k : 1, k);
+        for (int i = k - 1; i >= 0; --i)
+            adjust(i);
+        started_ = true;
+    }
+
+    std::vector<Input> inputs_;
+    std::vector<int> tree_; // tree_[0] holds the winner, tree_[1..k-1] the losers
+    std::vector<can_Frame> batch_;
+    uint64_t window_;
+    size_t batchSize_;
+    bool started_ = false;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file
+class can_MappedFile {
+  public:
+    can_MappedFile() {}
+    ~can_MappedFile() { close(); }
+
+    bool open(const char* path) {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_ == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size)) {
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(size.QuadPart);
+        if (size_ == 0)
+            return true;
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping_ == NULL) {
+            close();
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_ == NULL) {
+            close();
+            return false;
+        }
+#else
+        fd_ = ::open(path, O_RDONLY);
+        if (fd_ < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0)
+            return true;
+        void* p = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) {
+            close();
+            return false;
+        }
+        madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(p);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_)
+            UnmapViewOfFile(data_);
+        if (mapping_ != NULL)
+            CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE)
+            CloseHandle(file_);
+        mapping_ = NULL;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_)
+            munmap(const_cast<uint8_t*>(data_), size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool isOpen() const {
+#ifdef _WIN32
+        return file_ != INVALID_HANDLE_VALUE;
+#else
+        return fd_ >= 0;
+#endif
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+  private:
+    can_MappedFile(const can_MappedFile&);
+    can_MappedFile& operator=(const can_MappedFile&);
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = NULL;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+// Table-driven OBD-II (SAE J1979) mode 01 PID decoding.
+// Every PID formula is compiled to a signal over the PID's data bytes A, B, ...
+// (A is the most significant byte), with a factor and offset, so decoding is
+// one can_getSignal per value. A response may carry several PIDs; it is walked
+// once using the data length of each PID. No heap.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+static const uint8_t CAN_OBD_CURRENT_DATA = 0x01;
+static const uint8_t CAN_OBD_POSITIVE = 0x40; // added to the mode in responses
+
+struct can_ObdPid {
+    uint8_t pid;
+    uint8_t bytes;     // data bytes following the PID in a response
+    can_Signal signal; // over the data bytes; length 0 if the PID has no single value
+};
+
+// Standard mode 01 PIDs up to 0x60. 16-bit values are Motorola with the LSB in B
+// (start bit 8); single bytes are A (start bit 0).
+static const can_ObdPid CAN_OBD_PIDS[] = {
+    {0x00, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // PIDs supported 01-20
+    {0x01, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // monitor status
+    {0x02, 2, {8, 16, false, false, 1.0f, 0.0f}},                 // freeze DTC
+    {0x03, 2, {0, 0, false, false, 1.0f, 0.0f}},                  // fuel system status
+    {0x04, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // calculated load, %
+    {0x05, 1, {0, 8, false, false, 1.0f, -40.0f}},                // coolant temperature, degC
+    {0x06, 1, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // short term fuel trim bank 1, %
+    {0x07, 1, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // long term fuel trim bank 1, %
+    {0x08, 1, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // short term fuel trim bank 2, %
+    {0x09, 1, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // long term fuel trim bank 2, %
+    {0x0A, 1, {0, 8, false, false, 3.0f, 0.0f}},                  // fuel pressure, kPa
+    {0x0B, 1, {0, 8, false, false, 1.0f, 0.0f}},                  // intake manifold pressure, kPa
+    {0x0C, 2, {8, 16, false, false, 0.25f, 0.0f}},                // engine speed, rpm
+    {0x0D, 1, {0, 8, false, false, 1.0f, 0.0f}},                  // vehicle speed, km/h
+    {0x0E, 1, {0, 8, false, false, 0.5f, -64.0f}},                // timing advance, deg
+    {0x0F, 1, {0, 8, false, false, 1.0f, -40.0f}},                // intake air temperature, degC
+    {0x10, 2, {8, 16, false, false, 0.01f, 0.0f}},                // MAF air flow, g/s
+    {0x11, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // throttle position, %
+    {0x12, 1, {0, 0, false, false, 1.0f, 0.0f}},                  // commanded secondary air status
+    {0x13, 1, {0, 0, false, false, 1.0f, 0.0f}},                  // oxygen sensors present
+    {0x14, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 1 voltage, V
+    {0x15, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 2 voltage, V
+    {0x16, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 3 voltage, V
+    {0x17, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 4 voltage, V
+    {0x18, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 5 voltage, V
+    {0x19, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 6 voltage, V
+    {0x1A, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 7 voltage, V
+    {0x1B, 2, {0, 8, false, false, 0.005f, 0.0f}},                // O2 sensor 8 voltage, V
+    {0x1C, 1, {0, 8, false, false, 1.0f, 0.0f}},                  // OBD standard
+    {0x1D, 1, {0, 0, false, false, 1.0f, 0.0f}},                  // oxygen sensors present (4 banks)
+    {0x1E, 1, {0, 0, false, false, 1.0f, 0.0f}},                  // auxiliary input status
+    {0x1F, 2, {8, 16, false, false, 1.0f, 0.0f}},                 // run time since engine start, s
+    {0x20, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // PIDs supported 21-40
+    {0x21, 2, {8, 16, false, false, 1.0f, 0.0f}},                 // distance with MIL on, km
+    {0x22, 2, {8, 16, false, false, 0.079f, 0.0f}},               // fuel rail pressure (vacuum), kPa
+    {0x23, 2, {8, 16, false, false, 10.0f, 0.0f}},                // fuel rail gauge pressure, kPa
+    {0x24, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // O2 sensors, equivalence ratio / voltage
+    {0x25, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x26, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x27, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x28, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x29, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x2A, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x2B, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x2C, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // commanded EGR, %
+    {0x2D, 1, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // EGR error, %
+    {0x2E, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // commanded evaporative purge, %
+    {0x2F, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // fuel tank level, %
+    {0x30, 1, {0, 8, false, false, 1.0f, 0.0f}},                  // warm-ups since codes cleared
+    {0x31, 2, {8, 16, false, false, 1.0f, 0.0f}},                 // distance since codes cleared, km
+    {0x32, 2, {8, 16, false, true, 0.25f, 0.0f}},                 // evap system vapour pressure, Pa
+    {0x33, 1, {0, 8, false, false, 1.0f, 0.0f}},                  // barometric pressure, kPa
+    {0x34, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // O2 sensors, equivalence ratio / current
+    {0x35, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x36, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x37, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x38, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x39, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x3A, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x3B, 4, {0, 0, false, false, 1.0f, 0.0f}},
+    {0x3C, 2, {8, 16, false, false, 0.1f, -40.0f}},               // catalyst temperature B1S1, degC
+    {0x3D, 2, {8, 16, false, false, 0.1f, -40.0f}},               // catalyst temperature B2S1, degC
+    {0x3E, 2, {8, 16, false, false, 0.1f, -40.0f}},               // catalyst temperature B1S2, degC
+    {0x3F, 2, {8, 16, false, false, 0.1f, -40.0f}},               // catalyst temperature B2S2, degC
+    {0x40, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // PIDs supported 41-60
+    {0x41, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // monitor status this drive cycle
+    {0x42, 2, {8, 16, false, false, 0.001f, 0.0f}},               // control module voltage, V
+    {0x43, 2, {8, 16, false, false, 100.0f / 255.0f, 0.0f}},      // absolute load, %
+    {0x44, 2, {8, 16, false, false, 2.0f / 65536.0f, 0.0f}},      // commanded equivalence ratio
+    {0x45, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // relative throttle position, %
+    {0x46, 1, {0, 8, false, false, 1.0f, -40.0f}},                // ambient air temperature, degC
+    {0x47, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // absolute throttle position B, %
+    {0x48, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // absolute throttle position C, %
+    {0x49, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // accelerator pedal position D, %
+    {0x4A, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // accelerator pedal position E, %
+    {0x4B, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // accelerator pedal position F, %
+    {0x4C, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // commanded throttle actuator, %
+    {0x4D, 2, {8, 16, false, false, 1.0f, 0.0f}},                 // time run with MIL on, min
+    {0x4E, 2, {8, 16, false, false, 1.0f, 0.0f}},                 // time since codes cleared, min
+    {0x4F, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // maximum values
+    {0x50, 4, {0, 8, false, false, 10.0f, 0.0f}},                // maximum MAF, g/s
+    {0x51, 1, {0, 8, false, false, 1.0f, 0.0f}},                  // fuel type
+    {0x52, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // ethanol fuel, %
+    {0x53, 2, {8, 16, false, false, 0.005f, 0.0f}},               // absolute evap vapour pressure, kPa
+    {0x54, 2, {8, 16, false, true, 1.0f, 0.0f}},                  // evap vapour pressure, Pa
+    {0x55, 2, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // short term secondary O2 trim bank 1/3, %
+    {0x56, 2, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // long term secondary O2 trim bank 1/3, %
+    {0x57, 2, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // short term secondary O2 trim bank 2/4, %
+    {0x58, 2, {0, 8, false, false, 100.0f / 128.0f, -100.0f}},    // long term secondary O2 trim bank 2/4, %
+    {0x59, 2, {8, 16, false, false, 10.0f, 0.0f}},                // fuel rail absolute pressure, kPa
+    {0x5A, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // relative accelerator pedal position, %
+    {0x5B, 1, {0, 8, false, false, 100.0f / 255.0f, 0.0f}},       // hybrid battery remaining life, %
+    {0x5C, 1, {0, 8, false, false, 1.0f, -40.0f}},                // engine oil temperature, degC
+    {0x5D, 2, {8, 16, false, false, 1.0f / 128.0f, -210.0f}},     // fuel injection timing, deg
+    {0x5E, 2, {8, 16, false, false, 0.05f, 0.0f}},                // engine fuel rate, L/h
+    {0x5F, 1, {0, 0, false, false, 1.0f, 0.0f}},                  // emission requirements
+    {0x60, 4, {0, 0, false, false, 1.0f, 0.0f}},                  // PIDs supported 61-80
+};
+
+class can_ObdDecoder {
+  public:
+    // The table is not copied; later entries override earlier ones for the same PID
+    explicit can_ObdDecoder(const can_ObdPid* table = CAN_OBD_PIDS, const size_t count = sizeof(CAN_OBD_PIDS) / sizeof(CAN_OBD_PIDS[0])) {
+        for (size_t i = 0; i < 256; ++i)
+            index_[i] = nullptr;
+        add(table, count);
+    }
+
+    // Add manufacturer or newer PIDs on top of the current table
+    void add(const can_ObdPid* table, const size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            index_[table[i].pid] = &table[i];
+    }
+
+    const can_ObdPid* find(const uint8_t pid) const { return index_[pid]; }
+
+    // Decode a mode 01 response payload (0x41 PID data [PID data ...]), e.g. from
+    // ISO-TP. Writes the PID and value of every PID with a value, up to capacity,
+    // and returns how many; stops early at a PID whose length is unknown or a
+    // truncated entry.
+    size_t decodeResponse(const uint8_t* payload, const size_t size, uint8_t* pids, float* values, const size_t capacity) const {
+        if (size < 2 || payload[0] != (CAN_OBD_POSITIVE | CAN_OBD_CURRENT_DATA))
+            return 0;
+        size_t n = 0;
+        size_t pos = 1;
+        while (pos < size && n < capacity) {
+            const can_ObdPid* pid = index_[payload[pos]];
+            if (!pid || pos + 1 + pid->bytes > size)
+                break;
+            if (pid->signal.length) {
+                pids[n] = pid->pid;
+                values[n] = can_getSignal(payload + pos + 1, pid->bytes, pid->signal);
+                ++n;
+            }
+            pos += 1 + pid->bytes;
+        }
+        return n;
+    }
+
+    // Pull one PID out of logged single-frame responses; other frames are skipped.
+    // Returns the number of values written; timestamps may be null.
+    size_t decodeBatch(const can_Frame* frames, const size_t count, const uint8_t pid, float* values, uint64_t* timestamps) const {
+        const can_ObdPid* def = index_[pid];
+        if (!def || !def->signal.length)
+            return 0;
+        size_t n = 0;
+        uint8_t pids[7];
+        float decoded[7];
+        for (size_t i = 0; i < count; ++i) {
+            const can_Frame& f = frames[i];
+            const uint8_t pci = f.data[0];
+            if (f.len < 3 || (pci >> 4) != 0 || (pci & 0x0F) + 1u > f.len || f.data[1] != (CAN_OBD_POSITIVE | CAN_OBD_CURRENT_DATA))
+                continue;
+            const size_t found = decodeResponse(f.data + 1, pci & 0x0F, pids, decoded, 7);
+            for (size_t k = 0; k < found; ++k) {
+                if (pids[k] != pid)
+                    continue;
+                values[n] = decoded[k];
+                if (timestamps)
+                    timestamps[n] = f.timestamp;
+                ++n;
+                break;
+            }
+        }
+        return n;
+    }
+
+  private:
+    const can_ObdPid* index_[256];
+};
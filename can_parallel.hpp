@@ -0,0 +1,280 @@
+#pragma once
+
+// Parallel decoding of many PCAP / PCAPNG logs.
+// Files are cut into seekable chunks which run as tasks on a work-stealing
+// pool. Every task decodes the requested signals into its own column buffers,
+// and the per-task runs are merged in timestamp order at the end.
+// Host-side only.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "can_pcap.hpp"
+#include "can_timeseries.hpp"
+
+// Each worker owns a deque: it pushes and pops at the back, idle workers steal from the front
+class can_WorkStealingPool {
+  public:
+    typedef std::function<void(unsigned worker)> Task;
+
+    explicit can_WorkStealingPool(unsigned threads = 0) {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+        for (unsigned i = 0; i < threads; ++i)
+            queues_.push_back(std::unique_ptr<Queue>(new Queue));
+        for (unsigned i = 0; i < threads; ++i)
+            threads_.push_back(std::thread(&can_WorkStealingPool::run, this, i));
+    }
+
+    ~can_WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (size_t i = 0; i < threads_.size(); ++i)
+            threads_[i].join();
+    }
+
+    unsigned size() const { return static_cast<unsigned>(queues_.size()); }
+
+    // Queue a task on a worker; tasks spawned from a task should pass their own worker index
+    void submit(Task task, unsigned worker) {
+        ++pending_;
+        {
+            // Counted before it can be taken, so queued_ never drops below the real number
+            Queue& q = *queues_[worker % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            ++queued_;
+            q.tasks.push_back(std::move(task));
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_.notify_one();
+    }
+
+    void submit(Task task) { submit(std::move(task), next_++); }
+
+    // Block until every submitted task, including the ones they spawned, has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+  private:
+    can_WorkStealingPool(const can_WorkStealingPool&);
+    can_WorkStealingPool& operator=(const can_WorkStealingPool&);
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool take(const unsigned self, Task& task) {
+        {
+            Queue& own = *queues_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                --queued_;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues_.size(); ++i) {
+            Queue& victim = *queues_[(self + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --queued_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(const unsigned self) {
+        for (;;) {
+            Task task;
+            if (take(self, task)) {
+                task(self);
+                if (--pending_ == 0) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    done_.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+            if (stop_ && queued_ == 0)
+                return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue> > queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> queued_{0};
+    std::atomic<unsigned> next_{0};
+    bool stop_ = false;
+};
+
+struct can_SignalRequest {
+    uint32_t id;
+    bool extended;
+    can_Signal signal;
+};
+
+// Decode the requested signals from every file into one time-ordered column per request.
+// Files larger than chunkBytes are split at record boundaries so they can be shared between workers.
+inline bool can_decodeParallel(const std::vector<std::string>& files, const std::vector<can_SignalRequest>& requests, std::vector<can_SignalColumn>& out, const unsigned threads = 0, const size_t chunkBytes = 64 << 20) {
+    struct Run {
+        size_t file;
+        size_t chunk;
+        std::vector<can_SignalColumn> columns;
+    };
+
+    std::map<uint32_t, std::vector<size_t> > lookup;
+    for (size_t r = 0; r < requests.size(); ++r)
+        lookup[(requests[r].id & 0x1FFFFFFFu) | (requests[r].extended ? 0x80000000u : 0)].push_back(r);
+
+    can_WorkStealingPool pool(threads);
+    std::vector<std::vector<Run> > runs(pool.size()); // one list per worker, never shared
+    std::vector<std::vector<size_t> > headers(files.size()); // written before a file's chunks are queued
+    std::atomic<bool> ok(true);
+
+    const std::function<void(unsigned, size_t, size_t, size_t, size_t)> decodeChunk = [&](unsigned worker, size_t file, size_t chunk, size_t begin, size_t end) {
+        can_PcapReader reader;
+        if (!reader.open(files[file].c_str())) {
+            ok = false;
+            return;
+        }
+        reader.setHeaderBlocks(headers[file]);
+        const size_t stop = reader.sync(end);
+        if (!reader.seek(reader.sync(begin)))
+            return;
+
+        runs[worker].push_back(Run());
+        Run& run = runs[worker].back();
+        run.file = file;
+        run.chunk = chunk;
+        run.columns.resize(requests.size());
+
+        can_Frame batch[256];
+        for (bool more = true; more;) {
+            // A chunk owns the frames whose records start before its end
+            size_t n = 0;
+            while (n < 256 && (more = reader.next(batch[n]) && reader.frameOffset() < stop))
+                ++n;
+            for (size_t i = 0; i < n; ++i) {
+                const uint32_t key = batch[i].id | ((batch[i].flags & CAN_FRAME_EXTENDED) ? 0x80000000u : 0);
+                std::map<uint32_t, std::vector<size_t> >::const_iterator it = lookup.find(key);
+                if (it == lookup.end())
+                    continue;
+                for (size_t k = 0; k < it->second.size(); ++k) {
+                    can_SignalColumn& column = run.columns[it->second[k]];
+                    column.timestamps.push_back(batch[i].timestamp);
+                    column.values.push_back(can_getSignal(batch[i].data, batch[i].len, requests[it->second[k]].signal));
+                }
+            }
+        }
+
+        // Runs must be time-ordered for the merge; logs with local disorder are sorted here
+        for (size_t r = 0; r < run.columns.size(); ++r) {
+            can_SignalColumn& column = run.columns[r];
+            if (std::is_sorted(column.timestamps.begin(), column.timestamps.end()))
+                continue;
+            std::vector<std::pair<uint64_t, float> > pairs(column.timestamps.size());
+            for (size_t i = 0; i < pairs.size(); ++i)
+                pairs[i] = std::make_pair(column.timestamps[i], column.values[i]);
+            std::stable_sort(pairs.begin(), pairs.end(), [](const std::pair<uint64_t, float>& a, const std::pair<uint64_t, float>& b) {
+                return a.first < b.first;
+            });
+            for (size_t i = 0; i < pairs.size(); ++i) {
+                column.timestamps[i] = pairs[i].first;
+                column.values[i] = pairs[i].second;
+            }
+        }
+    };
+
+    for (size_t f = 0; f < files.size(); ++f) {
+        pool.submit([&, f](unsigned worker) {
+            can_PcapReader probe;
+            if (!probe.open(files[f].c_str())) {
+                ok = false;
+                return;
+            }
+            const size_t size = probe.size();
+            headers[f] = probe.headerBlocks();
+            probe.close();
+            const size_t chunks = chunkBytes ? (size + chunkBytes - 1) / chunkBytes : 1;
+            // Later chunks go on this worker's deque for others to steal; the first is decoded right here
+            for (size_t c = 1; c < chunks; ++c) {
+                const size_t end = (c + 1 == chunks) ? size : (c + 1) * chunkBytes;
+                pool.submit([&, f, c, end, chunkBytes](unsigned w) { decodeChunk(w, f, c, c * chunkBytes, end); }, worker);
+            }
+            decodeChunk(worker, f, 0, 0, chunks > 1 ? chunkBytes : size);
+        });
+    }
+    pool.wait();
+    if (!ok)
+        return false;
+
+    // Gather runs in file/chunk order so equal timestamps merge deterministically
+    std::vector<const Run*> ordered;
+    for (size_t w = 0; w < runs.size(); ++w) {
+        for (size_t i = 0; i < runs[w].size(); ++i)
+            ordered.push_back(&runs[w][i]);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const Run* a, const Run* b) {
+        return a->file != b->file ? a->file < b->file : a->chunk < b->chunk;
+    });
+
+    out.assign(requests.size(), can_SignalColumn());
+    for (size_t r = 0; r < requests.size(); ++r) {
+        pool.submit([&, r](unsigned) {
+            typedef std::pair<uint64_t, std::pair<size_t, size_t> > Head; // timestamp, (run, position)
+            std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+            size_t total = 0;
+            for (size_t i = 0; i < ordered.size(); ++i) {
+                const can_SignalColumn& column = ordered[i]->columns[r];
+                total += column.timestamps.size();
+                if (!column.timestamps.empty())
+                    heads.push(Head(column.timestamps[0], std::make_pair(i, 0)));
+            }
+
+            can_SignalColumn& merged = out[r];
+            merged.timestamps.reserve(total);
+            merged.values.reserve(total);
+            while (!heads.empty()) {
+                const Head head = heads.top();
+                heads.pop();
+                const size_t run = head.second.first;
+                const size_t pos = head.second.second;
+                const can_SignalColumn& column = ordered[run]->columns[r];
+                merged.timestamps.push_back(head.first);
+                merged.values.push_back(column.values[pos]);
+                if (pos + 1 < column.timestamps.size())
+                    heads.push(Head(column.timestamps[pos + 1], std::make_pair(run, pos + 1)));
+            }
+        });
+    }
+    pool.wait();
+    return true;
+}
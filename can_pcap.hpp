@@ -0,0 +1,582 @@
+#pragma once
+
+// PCAP / PCAPNG capture support for LINKTYPE_CAN_SOCKETCAN traces.
+// Host-side only: the reader memory-maps the capture and decodes records
+// straight out of the mapping into caller-provided can_Frame batches.
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include "can_helpers.hpp"
+#include "can_mmap.hpp"
+
+static const uint16_t CAN_LINKTYPE_SOCKETCAN = 227;
+
+// Decode one LINKTYPE_CAN_SOCKETCAN record (struct can_frame / canfd_frame).
+// The CAN ID word is stored in network byte order regardless of file endianness.
+inline bool can_parseSocketCan(const uint8_t* p, const size_t capLen, can_Frame& frame) {
+    if (capLen < 8)
+        return false;
+
+    uint32_t canId;
+    std::memcpy(&canId, p, 4);
+    canId = __builtin_bswap32(canId);
+
+    const uint8_t fdFlags = p[5];
+    uint8_t len = p[4];
+    const bool isFd = (fdFlags & 0x04) || len > 8 || capLen > 16;
+
+    frame.flags = 0;
+    if (canId & 0x80000000u)
+        frame.flags |= CAN_FRAME_EXTENDED;
+    if (canId & 0x40000000u)
+        frame.flags |= CAN_FRAME_RTR;
+    if (canId & 0x20000000u)
+        frame.flags |= CAN_FRAME_ERROR;
+    if (isFd) {
+        frame.flags |= CAN_FRAME_FD;
+        if (fdFlags & 0x01)
+            frame.flags |= CAN_FRAME_BRS;
+        if (fdFlags & 0x02)
+            frame.flags |= CAN_FRAME_ESI;
+    }
+    // Error frames carry their error class bits in the whole 29-bit field (CAN_ERR_MASK)
+    frame.id = canId & ((frame.flags & (CAN_FRAME_EXTENDED | CAN_FRAME_ERROR)) ? 0x1FFFFFFFu : 0x7FFu);
+
+    if (len > 64)
+        len = 64;
+    if (len > capLen - 8)
+        len = static_cast<uint8_t>(capLen - 8);
+    frame.len = len;
+    std::memcpy(frame.data, p + 8, len);
+    std::memset(frame.data + len, 0, sizeof(frame.data) - len);
+    return true;
+}
+
+// Zero-copy reader for classic PCAP and PCAPNG captures.
+// Records from interfaces with a link type other than LINKTYPE_CAN_SOCKETCAN are skipped.
+// In PCAPNG files the interface index becomes can_Frame::bus.
+class can_PcapReader {
+  public:
+    bool open(const char* path) {
+        close();
+        if (!file_.open(path) || file_.size() < 4) {
+            close();
+            return false;
+        }
+
+        uint32_t magic = read32(file_.data());
+        if (magic == 0x0A0D0D0Au) {
+            pcapng_ = true;
+        } else if (magic == 0xA1B2C3D4u || magic == 0xA1B23C4Du || magic == 0xD4C3B2A1u || magic == 0x4D3CB2A1u) {
+            pcapng_ = false;
+        } else {
+            close();
+            return false;
+        }
+        rewind();
+        return pos_ != 0;
+    }
+
+    void close() {
+        file_.close();
+        interfaces_.clear();
+        headers_.clear();
+        headersScanned_ = false;
+        pos_ = 0;
+        start_ = 0;
+        record_ = 0;
+    }
+
+    bool isOpen() const { return file_.isOpen(); }
+
+    // Restart from the first record
+    void rewind() {
+        pos_ = 0;
+        start_ = 0;
+        interfaces_.clear();
+        const uint8_t* p = file_.data();
+
+        if (pcapng_) {
+            // Consume the leading section header and interface descriptions
+            while (pos_ + 12 <= file_.size()) {
+                const uint32_t type = read32(p + pos_);
+                if (type != 0x0A0D0D0Au && get32(p + pos_) != 0x00000001u)
+                    break;
+                if (!headerBlock(p + pos_))
+                    break;
+            }
+            start_ = pos_;
+            return;
+        }
+
+        if (file_.size() < 24)
+            return;
+        const uint32_t magic = read32(p);
+        swap_ = (magic == 0xD4C3B2A1u || magic == 0x4D3CB2A1u);
+        Interface intf;
+        intf.linkType = static_cast<uint16_t>(get32(p + 20) & 0xFFFF);
+        intf.pow2 = false;
+        intf.exponent = (magic == 0xA1B23C4Du || magic == 0x4D3CB2A1u) ? 9 : 6;
+        interfaces_.push_back(intf);
+        pos_ = start_ = 24;
+    }
+
+    // Byte offset of the next record, usable with seek()
+    size_t offset() const { return pos_; }
+
+    // Byte offset of the record the last frame returned by next() was read from
+    size_t frameOffset() const { return record_; }
+
+    // Resume reading at an offset previously returned by offset() or frameOffset().
+    // For PCAPNG, the interfaces declared before the offset are restored from headerBlocks().
+    bool seek(const size_t offset) {
+        if (offset < start_ || offset > file_.size())
+            return false;
+        if (pcapng_) {
+            const std::vector<size_t>& headers = headerBlocks();
+            rewind();
+            for (size_t i = 0; i < headers.size() && headers[i] < offset; ++i) {
+                pos_ = headers[i];
+                if (!headerBlock(file_.data() + pos_))
+                    break;
+            }
+        }
+        pos_ = offset;
+        return true;
+    }
+
+    // Offsets of the PCAPNG section headers and interface descriptions that follow
+    // the first packet; a writer adding buses as they show up produces these. Found
+    // by one pass over the block headers on first use. Readers of the same file,
+    // e.g. one per shard, can share the result with setHeaderBlocks().
+    const std::vector<size_t>& headerBlocks() {
+        if (!headersScanned_) {
+            headers_ = scanHeaderBlocks();
+            headersScanned_ = true;
+        }
+        return headers_;
+    }
+
+    void setHeaderBlocks(const std::vector<size_t>& headers) {
+        headers_ = headers;
+        headersScanned_ = true;
+    }
+
+    // First record boundary at or after an arbitrary byte offset, or size() if there is none.
+    // PCAPNG blocks repeat their length in a trailer, which makes this reliable; classic PCAP
+    // records are accepted when three consecutive headers look like complete SocketCAN
+    // records whose timestamps are within an hour of each other.
+    size_t sync(size_t offset) const {
+        if (offset < start_)
+            return start_;
+        const size_t size = file_.size();
+        if (pcapng_) {
+            offset = start_ + ((offset - start_ + 3) & ~static_cast<size_t>(3));
+            for (; offset + 12 <= size; offset += 4) {
+                size_t pos = offset;
+                int valid = 0;
+                while (valid < 2 && pos + 12 <= size) {
+                    const uint32_t blockLen = get32(file_.data() + pos + 4);
+                    if (blockLen < 12 || (blockLen & 3) || pos + blockLen > size || get32(file_.data() + pos + blockLen - 4) != blockLen)
+                        break;
+                    pos += blockLen;
+                    ++valid;
+                }
+                if (valid == 2 || (valid == 1 && pos == size))
+                    return offset;
+            }
+            return size;
+        }
+
+        for (; offset + 16 <= size; ++offset) {
+            size_t pos = offset;
+            int valid = 0;
+            uint32_t prevSec = 0;
+            while (valid < 3 && pos + 16 <= size) {
+                const uint8_t* rec = file_.data() + pos;
+                const uint32_t sec = get32(rec);
+                const uint32_t capLen = get32(rec + 8);
+                if (capLen < 8 || capLen > 72 || capLen != get32(rec + 12) || get32(rec + 4) >= 1000000000u || pos + 16 + capLen > size)
+                    break;
+                if (rec[16 + 4] > capLen - 8 || (valid > 0 && (sec - prevSec + 3600u) > 7200u))
+                    break;
+                prevSec = sec;
+                pos += 16 + capLen;
+                ++valid;
+            }
+            if (valid == 3 || (valid > 0 && pos == size))
+                return offset;
+        }
+        return size;
+    }
+
+    size_t size() const { return file_.size(); }
+
+    bool next(can_Frame& frame) {
+        return pcapng_ ? nextPcapng(frame) : nextPcap(frame);
+    }
+
+    // Fill up to maxFrames frames; returns 0 at end of file
+    size_t readBatch(can_Frame* frames, const size_t maxFrames) {
+        size_t n = 0;
+        while (n < maxFrames && next(frames[n]))
+            ++n;
+        return n;
+    }
+
+  private:
+    struct Interface {
+        uint16_t linkType;
+        bool pow2;
+        uint8_t exponent;
+    };
+
+    static uint32_t read32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    uint16_t get16(const uint8_t* p) const {
+        uint16_t v;
+        std::memcpy(&v, p, 2);
+        return swap_ ? __builtin_bswap16(v) : v;
+    }
+
+    uint32_t get32(const uint8_t* p) const {
+        const uint32_t v = read32(p);
+        return swap_ ? __builtin_bswap32(v) : v;
+    }
+
+    std::vector<size_t> scanHeaderBlocks() const {
+        std::vector<size_t> headers;
+        const uint8_t* p = file_.data();
+        const size_t size = file_.size();
+        bool swap = false;
+        for (size_t pos = 0; pcapng_ && pos + 12 <= size;) {
+            uint32_t type = read32(p + pos);
+            if (type == 0x0A0D0D0Au) {
+                const uint32_t bom = read32(p + pos + 8);
+                if (bom != 0x1A2B3C4Du && bom != 0x4D3C2B1Au)
+                    break;
+                swap = bom == 0x4D3C2B1Au;
+            }
+            uint32_t blockLen = read32(p + pos + 4);
+            if (swap) {
+                type = __builtin_bswap32(type);
+                blockLen = __builtin_bswap32(blockLen);
+            }
+            if (blockLen < 12 || (blockLen & 3) || pos + blockLen > size)
+                break;
+            if (pos >= start_ && (type == 0x0A0D0D0Au || type == 0x00000001u))
+                headers.push_back(pos);
+            pos += blockLen;
+        }
+        return headers;
+    }
+
+    // Exponents are limited to what the 64-bit arithmetic holds when the interface is declared
+    static uint64_t toMicros(const uint64_t ts, const Interface& intf) {
+        if (intf.pow2) {
+            const uint64_t mask = (1ULL << intf.exponent) - 1ULL;
+            // Keep at most 40 fraction bits so the multiply by 10^6 cannot overflow
+            const uint8_t drop = intf.exponent > 40 ? intf.exponent - 40 : 0;
+            return (ts >> intf.exponent) * 1000000ULL + ((((ts & mask) >> drop) * 1000000ULL) >> (intf.exponent - drop));
+        }
+        uint64_t scale = 1;
+        if (intf.exponent <= 6) {
+            for (uint8_t i = intf.exponent; i < 6; ++i)
+                scale *= 10;
+            return ts * scale;
+        }
+        for (uint8_t i = 6; i < intf.exponent; ++i)
+            scale *= 10;
+        return ts / scale;
+    }
+
+    bool nextPcap(can_Frame& frame) {
+        const uint8_t* base = file_.data();
+        const size_t size = file_.size();
+        if (interfaces_.empty())
+            return false;
+        const Interface& intf = interfaces_[0];
+
+        while (pos_ + 16 <= size) {
+            const uint8_t* rec = base + pos_;
+            const uint32_t sec = get32(rec);
+            const uint32_t frac = get32(rec + 4);
+            const uint32_t capLen = get32(rec + 8);
+            if (pos_ + 16 + capLen > size)
+                break;
+            record_ = pos_;
+            pos_ += 16 + capLen;
+
+            if (intf.linkType != CAN_LINKTYPE_SOCKETCAN || !can_parseSocketCan(rec + 16, capLen, frame))
+                continue;
+            frame.timestamp = sec * 1000000ULL + (intf.exponent == 9 ? frac / 1000 : frac);
+            frame.bus = 0;
+            return true;
+        }
+        pos_ = size;
+        return false;
+    }
+
+    // Process a section header or interface description block and advance past it
+    bool headerBlock(const uint8_t* blk) {
+        const size_t size = file_.size();
+        if (read32(blk) == 0x0A0D0D0Au) {
+            // The byte order magic decides endianness for the whole section
+            if (pos_ + 28 > size)
+                return false;
+            const uint32_t bom = read32(blk + 8);
+            if (bom == 0x1A2B3C4Du)
+                swap_ = false;
+            else if (bom == 0x4D3C2B1Au)
+                swap_ = true;
+            else
+                return false;
+            interfaces_.clear();
+        }
+
+        const uint32_t type = get32(blk);
+        const uint32_t blockLen = get32(blk + 4);
+        if (blockLen < 12 || (blockLen & 3) || pos_ + blockLen > size)
+            return false;
+        pos_ += blockLen;
+
+        if (type == 0x00000001u && blockLen >= 20) {
+            Interface intf;
+            intf.linkType = get16(blk + 8);
+            intf.pow2 = false;
+            intf.exponent = 6;
+            // Walk the options looking for if_tsresol
+            size_t opt = 16;
+            while (opt + 4 <= blockLen - 4) {
+                const uint16_t code = get16(blk + opt);
+                const uint16_t optLen = get16(blk + opt + 2);
+                if (code == 0)
+                    break;
+                if (code == 9 && optLen >= 1) {
+                    const uint8_t res = blk[opt + 4];
+                    intf.pow2 = (res & 0x80) != 0;
+                    intf.exponent = res & 0x7F;
+                }
+                opt += 4 + ((optLen + 3u) & ~3u);
+            }
+            // A resolution finer than 2^-63 or 10^-25 s cannot be converted; the interface keeps
+            // its index but its packets are skipped like those of any other link type
+            if (intf.exponent > (intf.pow2 ? 63 : 25))
+                intf.linkType = 0;
+            interfaces_.push_back(intf);
+        }
+        return true;
+    }
+
+    bool nextPcapng(can_Frame& frame) {
+        const uint8_t* base = file_.data();
+        const size_t size = file_.size();
+
+        while (pos_ + 12 <= size) {
+            const uint8_t* blk = base + pos_;
+            const uint32_t type = get32(blk);
+            if (read32(blk) == 0x0A0D0D0Au || type != 0x00000006u) {
+                if (!headerBlock(blk))
+                    break;
+                continue;
+            }
+
+            const uint32_t blockLen = get32(blk + 4);
+            if (blockLen < 32 || (blockLen & 3) || pos_ + blockLen > size)
+                break;
+            record_ = pos_;
+            pos_ += blockLen;
+
+            const uint32_t ifId = get32(blk + 8);
+            const uint32_t capLen = get32(blk + 20);
+            if (ifId >= interfaces_.size() || capLen > blockLen - 32)
+                continue;
+            const Interface& intf = interfaces_[ifId];
+            if (intf.linkType != CAN_LINKTYPE_SOCKETCAN || !can_parseSocketCan(blk + 28, capLen, frame))
+                continue;
+            const uint64_t ts = (static_cast<uint64_t>(get32(blk + 12)) << 32) | get32(blk + 16);
+            frame.timestamp = toMicros(ts, intf);
+            frame.bus = static_cast<uint8_t>(ifId);
+            return true;
+        }
+        pos_ = size;
+        return false;
+    }
+
+    can_MappedFile file_;
+    std::vector<Interface> interfaces_;
+    std::vector<size_t> headers_;
+    size_t pos_ = 0;
+    size_t start_ = 0;
+    size_t record_ = 0;
+    bool headersScanned_ = false;
+    bool pcapng_ = false;
+    bool swap_ = false;
+};
+
+enum can_PcapFormat {
+    CAN_PCAP,
+    CAN_PCAPNG,
+};
+
+// Buffered LINKTYPE_CAN_SOCKETCAN writer. Timestamps are written with microsecond resolution.
+// For PCAPNG one interface is declared per bus so that can_Frame::bus round-trips through the reader.
+class can_PcapWriter {
+  public:
+    can_PcapWriter() {}
+    explicit can_PcapWriter(const char* path, const can_PcapFormat format = CAN_PCAPNG, const uint8_t buses = 1, const size_t bufferSize = 1 << 16) {
+        open(path, format, buses, bufferSize);
+    }
+    ~can_PcapWriter() { close(); }
+
+    // Interfaces for buses 0..buses-1 are declared up front; frames on higher buses declare theirs on first use
+    bool open(const char* path, const can_PcapFormat format = CAN_PCAPNG, const uint8_t buses = 1, const size_t bufferSize = 1 << 16) {
+        close();
+        file_ = std::fopen(path, "wb");
+        if (!file_)
+            return false;
+        format_ = format;
+        interfaces_ = 0;
+        buffer_.reserve(bufferSize < 256 ? 256 : bufferSize);
+
+        if (format_ == CAN_PCAPNG) {
+            put32(0x0A0D0D0Au);
+            put32(28);
+            put32(0x1A2B3C4Du);
+            put16(1);
+            put16(0);
+            put32(0xFFFFFFFFu);
+            put32(0xFFFFFFFFu);
+            put32(28);
+            while (interfaces_ < buses)
+                putInterface();
+        } else {
+            put32(0xA1B2C3D4u);
+            put16(2);
+            put16(4);
+            put32(0);
+            put32(0);
+            put32(72);
+            put32(CAN_LINKTYPE_SOCKETCAN);
+        }
+        return true;
+    }
+
+    bool isOpen() const { return file_ != nullptr; }
+
+    bool write(const can_Frame& frame) {
+        if (!file_)
+            return false;
+        if (buffer_.capacity() - buffer_.size() < 128 && !flush())
+            return false;
+
+        const bool isFd = (frame.flags & CAN_FRAME_FD) != 0;
+        const uint32_t capLen = isFd ? 72 : 16;
+        const uint32_t sec = static_cast<uint32_t>(frame.timestamp / 1000000ULL);
+        const uint32_t usec = static_cast<uint32_t>(frame.timestamp % 1000000ULL);
+
+        if (format_ == CAN_PCAPNG) {
+            while (interfaces_ <= frame.bus)
+                putInterface();
+            put32(0x00000006u);
+            put32(32 + capLen);
+            put32(frame.bus);
+            put32(static_cast<uint32_t>(frame.timestamp >> 32));
+            put32(static_cast<uint32_t>(frame.timestamp));
+            put32(capLen);
+            put32(capLen);
+        } else {
+            put32(sec);
+            put32(usec);
+            put32(capLen);
+            put32(capLen);
+        }
+
+        uint32_t canId = frame.id;
+        if (frame.flags & CAN_FRAME_EXTENDED)
+            canId |= 0x80000000u;
+        if (frame.flags & CAN_FRAME_RTR)
+            canId |= 0x40000000u;
+        if (frame.flags & CAN_FRAME_ERROR)
+            canId |= 0x20000000u;
+        canId = __builtin_bswap32(canId);
+
+        uint8_t header[8] = {0};
+        std::memcpy(header, &canId, 4);
+        header[4] = frame.len;
+        if (isFd) {
+            header[5] = 0x04;
+            if (frame.flags & CAN_FRAME_BRS)
+                header[5] |= 0x01;
+            if (frame.flags & CAN_FRAME_ESI)
+                header[5] |= 0x02;
+        }
+        buffer_.insert(buffer_.end(), header, header + 8);
+        buffer_.insert(buffer_.end(), frame.data, frame.data + (capLen - 8));
+
+        if (format_ == CAN_PCAPNG)
+            put32(32 + capLen);
+        return true;
+    }
+
+    bool write(const can_Frame* frames, const size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!write(frames[i]))
+                return false;
+        }
+        return true;
+    }
+
+    bool flush() {
+        if (!file_)
+            return false;
+        const bool ok = buffer_.empty() || std::fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+        buffer_.clear();
+        return ok;
+    }
+
+    bool close() {
+        if (!file_)
+            return true;
+        bool ok = flush();
+        ok = (std::fclose(file_) == 0) && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+  private:
+    can_PcapWriter(const can_PcapWriter&);
+    can_PcapWriter& operator=(const can_PcapWriter&);
+
+    void putInterface() {
+        put32(0x00000001u);
+        put32(20);
+        put16(CAN_LINKTYPE_SOCKETCAN);
+        put16(0);
+        put32(72);
+        put32(20);
+        ++interfaces_;
+    }
+
+    void put16(const uint16_t v) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+        buffer_.insert(buffer_.end(), p, p + 2);
+    }
+
+    void put32(const uint32_t v) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+        buffer_.insert(buffer_.end(), p, p + 4);
+    }
+
+    std::FILE* file_ = nullptr;
+    std::vector<uint8_t> buffer_;
+    can_PcapFormat format_ = CAN_PCAPNG;
+    uint32_t interfaces_ = 0;
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+// Cyclic / on-change transmit scheduler on a hierarchical timing wheel.
+// Messages are assembled in place with can_setSignal and handed to a transmit
+// callback when due. The scheduler never reads a clock: the application calls
+// advance() with its own tick count, so the same code runs on a target's
+// timer interrupt, on Linux against vcan, or under a simulated clock.
+// Fixed capacity, no heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+#include "can_timer.hpp"
+
+enum can_TxMode {
+    CAN_TX_CYCLIC,    // every period
+    CAN_TX_ON_CHANGE, // only when the payload changes
+    CAN_TX_MIXED,     // every period, plus immediately on change
+};
+
+struct can_TxMessage {
+    uint32_t id;
+    bool extended;
+    uint8_t len;
+    can_TxMode mode;
+    uint32_t period; // ticks, for cyclic and mixed messages
+    uint32_t offset; // ticks after start() of the first cyclic transmission
+    uint32_t minGap; // minimum ticks between two transmissions caused by changes
+};
+
+template <size_t Count>
+class can_TxScheduler {
+  public:
+    can_TxScheduler(const can_TransmitFn transmit, void* context) : transmit_(transmit), context_(context) {}
+
+    // Returns the message index, or -1 when full. Payloads start zeroed.
+    int add(const can_TxMessage& config) {
+        if (count_ >= Count)
+            return -1;
+        Entry& e = entries_[count_];
+        e.config = config;
+        std::memset(e.data, 0, sizeof(e.data));
+        e.owner = this;
+        e.lastTx = 0;
+        e.sent = false;
+        can_initTimer(e.cyclic, &can_TxScheduler::onCyclic, &e);
+        can_initTimer(e.deferred, &can_TxScheduler::onDeferred, &e);
+        return static_cast<int>(count_++);
+    }
+
+    // Spread the offsets of messages sharing a period evenly over that period
+    void stagger() {
+        for (size_t i = 0; i < count_; ++i) {
+            const uint32_t period = entries_[i].config.period;
+            if (entries_[i].config.mode == CAN_TX_ON_CHANGE || period == 0)
+                continue;
+            size_t rank = 0, group = 0;
+            for (size_t j = 0; j < count_; ++j) {
+                if (entries_[j].config.period != period || entries_[j].config.mode == CAN_TX_ON_CHANGE)
+                    continue;
+                if (j < i)
+                    ++rank;
+                ++group;
+            }
+            entries_[i].config.offset = static_cast<uint32_t>(static_cast<uint64_t>(period) * rank / group);
+        }
+    }
+
+    // Arm the cyclic timers relative to now
+    void start(const uint64_t now) {
+        if (now > wheel_.now())
+            wheel_.advance(now - 1);
+        now_ = now;
+        for (size_t i = 0; i < count_; ++i) {
+            Entry& e = entries_[i];
+            if (e.config.mode != CAN_TX_ON_CHANGE && e.config.period > 0)
+                wheel_.schedule(e.cyclic, now + e.config.offset);
+        }
+    }
+
+    // Transmit everything due at or before now; returns the number of timers fired
+    size_t advance(const uint64_t now) {
+        const size_t fired = wheel_.advance(now);
+        now_ = now;
+        return fired;
+    }
+
+    uint8_t (&data(const size_t index))[8] { return entries_[index].data; }
+
+    template <typename T>
+    void setSignal(const size_t index, const T& val, const size_t startBit, const size_t length, const bool isIntel) {
+        Entry& e = entries_[index];
+        uint8_t before[8];
+        std::memcpy(before, e.data, 8);
+        can_setSignal<T>(e.data, val, startBit, length, isIntel);
+        if (std::memcmp(before, e.data, 8) != 0)
+            changed(index);
+    }
+
+    template <typename T>
+    void setSignal(const size_t index, const float& val, const size_t startBit, const size_t length, const bool isIntel, const float factor, const float offset) {
+        setSignal<T>(index, static_cast<T>((val - offset) / factor), startBit, length, isIntel);
+    }
+
+    // Report a payload change made through data(); on-change and mixed messages transmit
+    // now, or once minGap has passed since the last transmission
+    void changed(const size_t index) {
+        Entry& e = entries_[index];
+        if (e.config.mode == CAN_TX_CYCLIC)
+            return;
+        if (!e.sent || now_ >= e.lastTx + e.config.minGap) {
+            send(e, now_);
+        } else if (!can_TimerWheel<>::pending(e.deferred)) {
+            wheel_.schedule(e.deferred, e.lastTx + e.config.minGap);
+        }
+    }
+
+  private:
+    struct Entry {
+        can_TxMessage config;
+        uint8_t data[8];
+        can_TxScheduler* owner;
+        can_Timer cyclic;
+        can_Timer deferred;
+        uint64_t lastTx;
+        bool sent;
+    };
+
+    void send(Entry& e, const uint64_t now) {
+        wheel_.cancel(e.deferred);
+        transmit_(context_, e.config.id, e.config.extended, e.data, e.config.len);
+        e.lastTx = now;
+        e.sent = true;
+    }
+
+    static void onCyclic(void* context, can_Timer& timer, const uint64_t now) {
+        Entry& e = *static_cast<Entry*>(context);
+        e.owner->send(e, now);
+        e.owner->wheel_.schedule(timer, timer.expiry + e.config.period);
+    }
+
+    static void onDeferred(void* context, can_Timer&, const uint64_t now) {
+        Entry& e = *static_cast<Entry*>(context);
+        e.owner->send(e, now);
+    }
+
+    can_TimerWheel<> wheel_;
+    Entry entries_[Count];
+    size_t count_ = 0;
+    uint64_t now_ = 0;
+    can_TransmitFn transmit_;
+    void* context_;
+};
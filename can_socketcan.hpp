@@ -0,0 +1,92 @@
+#pragma once
+
+// Minimal Linux SocketCAN adapter, e.g. for running the TX scheduler against vcan.
+// Host only.
+
+#include <cstring>
+#include <stdint.h>
+
+#include <linux/can.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "can_helpers.hpp"
+
+class can_SocketCan {
+  public:
+    can_SocketCan() {}
+    ~can_SocketCan() { close(); }
+
+    // Bind a raw CAN socket to an interface such as "vcan0"
+    bool open(const char* interface) {
+        close();
+        fd_ = ::socket(PF_CAN, SOCK_RAW, CAN_RAW);
+        if (fd_ < 0)
+            return false;
+        struct ifreq ifr;
+        std::memset(&ifr, 0, sizeof(ifr));
+        std::strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+        struct sockaddr_can addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.can_family = AF_CAN;
+        if (::ioctl(fd_, SIOCGIFINDEX, &ifr) < 0) {
+            close();
+            return false;
+        }
+        addr.can_ifindex = ifr.ifr_ifindex;
+        if (::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    bool send(const uint32_t id, const bool extended, const uint8_t (&data)[8], const uint8_t len) {
+        struct can_frame frame;
+        std::memset(&frame, 0, sizeof(frame));
+        frame.can_id = extended ? ((id & CAN_EFF_MASK) | CAN_EFF_FLAG) : (id & CAN_SFF_MASK);
+        frame.can_dlc = len > 8 ? 8 : len;
+        std::memcpy(frame.data, data, frame.can_dlc);
+        return ::write(fd_, &frame, sizeof(frame)) == static_cast<ssize_t>(sizeof(frame));
+    }
+
+    // Blocking read of one classic frame; timestamp is left at 0
+    bool receive(can_Frame& out) {
+        struct can_frame frame;
+        if (::read(fd_, &frame, sizeof(frame)) != static_cast<ssize_t>(sizeof(frame)))
+            return false;
+        std::memset(&out, 0, sizeof(out));
+        if (frame.can_id & CAN_EFF_FLAG) {
+            out.id = frame.can_id & CAN_EFF_MASK;
+            out.flags |= CAN_FRAME_EXTENDED;
+        } else {
+            out.id = frame.can_id & CAN_SFF_MASK;
+        }
+        if (frame.can_id & CAN_RTR_FLAG)
+            out.flags |= CAN_FRAME_RTR;
+        out.len = frame.can_dlc;
+        std::memcpy(out.data, frame.data, frame.can_dlc > 8 ? 8 : frame.can_dlc);
+        return true;
+    }
+
+    // Matches can_TransmitFn with the socket as context
+    static bool transmit(void* context, const uint32_t id, const bool extended, const uint8_t (&data)[8], const uint8_t len) {
+        return static_cast<can_SocketCan*>(context)->send(id, extended, data, len);
+    }
+
+  private:
+    can_SocketCan(const can_SocketCan&);
+    can_SocketCan& operator=(const can_SocketCan&);
+
+    int fd_ = -1;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+// Dirty-tracking message staging for the TX path.
+// The application writes physical (or raw) signal values every cycle; only the
+// signals whose raw value actually changed are marked dirty, and pack() merges
+// all dirty signals into the payload with a single load and store per byte
+// order. A sticky "changed" flag records whether the payload differs from the
+// last transmitted one, which is exactly the trigger on-change messages need.
+// Fixed capacity, no heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+// Outcome of packing into a frame to transmit
+enum can_StageResult : uint8_t {
+    CAN_STAGE_UNCHANGED,   // frame ready, payload as last packed
+    CAN_STAGE_CHANGED,     // frame ready, payload changed
+    CAN_STAGE_UNPROTECTED, // protection failed; the frame must not be sent
+};
+
+template <size_t Signals>
+class can_MessageStage {
+    static_assert(Signals <= 64, "dirty set is a 64-bit mask");
+
+  public:
+    can_MessageStage() { std::memset(data_, 0, sizeof(data_)); }
+
+    // The descriptors are copied; the payload starts zeroed
+    can_MessageStage(const can_Signal* signals, const size_t count) : can_MessageStage() {
+        for (size_t i = 0; i < count; ++i)
+            add(signals[i]);
+    }
+
+    // Returns the signal number, or -1 when full
+    int add(const can_Signal& signal) {
+        if (count_ >= Signals)
+            return -1;
+        Slot& slot = slots_[count_];
+        slot.signal = signal;
+        slot.fieldMask = signal.length < 64 ? (1ULL << signal.length) - 1ULL : -1ULL;
+        slot.shift = signal.isIntel ? signal.startBit : (56 - signal.startBit + (2 * (signal.startBit % 8)));
+        slot.raw = can_getRawSignal(data_, signal);
+        return static_cast<int>(count_++);
+    }
+
+    size_t size() const { return count_; }
+
+    // Cheap when the value is unchanged: one conversion and one compare
+    void set(const size_t index, const float value) { setRaw(index, can_toRaw(value, slots_[index].signal)); }
+
+    void setRaw(const size_t index, const int64_t raw) {
+        Slot& slot = slots_[index];
+        if ((static_cast<uint64_t>(raw ^ slot.raw) & slot.fieldMask) == 0)
+            return;
+        slot.raw = raw;
+        dirty_ |= 1ULL << index;
+    }
+
+    int64_t raw(const size_t index) const { return slots_[index].raw; }
+    bool dirty() const { return dirty_ != 0; }
+
+    // Merge the dirty signals into the payload; returns true if any payload bit changed
+    bool pack() {
+        if (!dirty_)
+            return false;
+        uint64_t intelClear = 0, intelBits = 0, motoClear = 0, motoBits = 0;
+        for (uint64_t pending = dirty_; pending; pending &= pending - 1) {
+            const Slot& slot = slots_[__builtin_ctzll(pending)];
+            const uint64_t bits = (static_cast<uint64_t>(slot.raw) & slot.fieldMask) << slot.shift;
+            if (slot.signal.isIntel) {
+                intelClear |= slot.fieldMask << slot.shift;
+                intelBits |= bits;
+            } else {
+                motoClear |= slot.fieldMask << slot.shift;
+                motoBits |= bits;
+            }
+        }
+        dirty_ = 0;
+
+        uint64_t before, word;
+        std::memcpy(&before, data_, 8);
+        word = (before & ~intelClear) | intelBits;
+        if (motoClear)
+            word = __builtin_bswap64((__builtin_bswap64(word) & ~motoClear) | motoBits);
+        if (word == before)
+            return false;
+        std::memcpy(data_, &word, 8);
+        changed_ = true;
+        return true;
+    }
+
+    // Pack, then finish the frame to transmit in the same call: frame receives the
+    // payload and protection.protect(frame, 8) adds per-transmission fields such as
+    // an E2E counter and CRC (see can_E2EProtector). Those fields stay out of the
+    // staged payload, so they never count as a change. A failed protect() is
+    // reported instead of the change; the change stays visible through changed().
+    template <typename Protection>
+    can_StageResult pack(uint8_t (&frame)[8], Protection& protection) {
+        const bool changed = pack();
+        std::memcpy(frame, data_, 8);
+        if (!protection.protect(frame, 8))
+            return CAN_STAGE_UNPROTECTED;
+        return changed ? CAN_STAGE_CHANGED : CAN_STAGE_UNCHANGED;
+    }
+
+    // True once pack() has altered the payload since the last markSent()
+    bool changed() const { return changed_; }
+    void markSent() { changed_ = false; }
+
+    const uint8_t (&data() const)[8] { return data_; }
+
+  private:
+    struct Slot {
+        can_Signal signal;
+        uint64_t fieldMask;
+        uint64_t shift;
+        int64_t raw;
+    };
+
+    Slot slots_[Signals];
+    uint8_t data_[8];
+    size_t count_ = 0;
+    uint64_t dirty_ = 0;
+    bool changed_ = false;
+};
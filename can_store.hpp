@@ -0,0 +1,132 @@
+#pragma once
+
+// Latest-frame store for "current value of signal X" lookups.
+// One entry per message, addressed by a dense message index. Each entry is a
+// seqlock: the RX path publishes without blocking and readers retry instead of
+// ever seeing a torn frame. Entries are cache-line sized so hot messages
+// written by one core do not invalidate their neighbours on another.
+// An entry can be marked stale, e.g. by can_DeadlineMonitor when its message
+// stops arriving; it then reads as invalid until the next write.
+
+#include <atomic>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+#ifndef CAN_CACHE_LINE
+#define CAN_CACHE_LINE 64
+#endif
+
+struct alignas(CAN_CACHE_LINE) can_StoreEntry {
+    std::atomic<uint32_t> sequence; // odd while a write is in progress, 0 if never written
+    std::atomic<uint32_t> words[2];
+    std::atomic<uint32_t> timestamp[2];
+    std::atomic<uint32_t> stale; // set by invalidate(), cleared by the next write
+};
+
+// Only one thread may write a given entry; any number of threads may read.
+// Indices outside the store are ignored by writes and read as invalid.
+template <size_t Count>
+class can_LatestStore {
+  public:
+    can_LatestStore() {
+        for (size_t i = 0; i < Count; ++i) {
+            entries_[i].sequence.store(0, std::memory_order_relaxed);
+            entries_[i].words[0].store(0, std::memory_order_relaxed);
+            entries_[i].words[1].store(0, std::memory_order_relaxed);
+            entries_[i].timestamp[0].store(0, std::memory_order_relaxed);
+            entries_[i].timestamp[1].store(0, std::memory_order_relaxed);
+            entries_[i].stale.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static size_t size() { return Count; }
+
+    void write(const size_t index, const uint8_t (&buf)[8], const uint64_t timestamp) {
+        if (index < Count)
+            publish(entries_[index], buf, timestamp);
+    }
+
+    // Mark the latest frame as out of date. May be called from any thread; a write
+    // racing with it may be marked stale as well, until the write after it.
+    void invalidate(const size_t index) {
+        if (index < Count)
+            entries_[index].stale.store(1, std::memory_order_release);
+    }
+
+    bool valid(const size_t index) const {
+        if (index >= Count)
+            return false;
+        const can_StoreEntry& e = entries_[index];
+        return e.sequence.load(std::memory_order_acquire) != 0 && e.stale.load(std::memory_order_acquire) == 0;
+    }
+
+    // Consistent copy of the latest frame; false if the entry was never written or
+    // is stale, in which case buf still receives the last frame. An index outside
+    // the store returns false and leaves buf alone.
+    bool read(const size_t index, uint8_t (&buf)[8], uint64_t* timestamp = nullptr) const {
+        if (index >= Count)
+            return false;
+        const can_StoreEntry& e = entries_[index];
+        uint32_t words[2], ts[2], seq, stale;
+        for (;;) {
+            seq = e.sequence.load(std::memory_order_acquire);
+            if (seq & 1)
+                continue;
+            words[0] = e.words[0].load(std::memory_order_relaxed);
+            words[1] = e.words[1].load(std::memory_order_relaxed);
+            ts[0] = e.timestamp[0].load(std::memory_order_relaxed);
+            ts[1] = e.timestamp[1].load(std::memory_order_relaxed);
+            stale = e.stale.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.sequence.load(std::memory_order_relaxed) == seq)
+                break;
+        }
+        std::memcpy(buf, words, 8);
+        if (timestamp)
+            *timestamp = ts[0] | (static_cast<uint64_t>(ts[1]) << 32);
+        return seq != 0 && stale == 0;
+    }
+
+    template <typename T>
+    T getSignal(const size_t index, const size_t startBit, const size_t length, const bool isIntel) const {
+        uint8_t buf[8] = {0};
+        read(index, buf);
+        return can_getSignal<T>(buf, startBit, length, isIntel);
+    }
+
+    float getSignal(const size_t index, const can_Signal& sig) const {
+        uint8_t buf[8] = {0};
+        read(index, buf);
+        return can_getSignal(buf, sig);
+    }
+
+    // Returns false, leaving value alone, if the entry was never written or is stale
+    bool getSignal(const size_t index, const can_Signal& sig, float& value) const {
+        uint8_t buf[8];
+        if (!read(index, buf))
+            return false;
+        value = can_getSignal(buf, sig);
+        return true;
+    }
+
+  private:
+    static void publish(can_StoreEntry& e, const uint8_t (&buf)[8], const uint64_t timestamp) {
+        uint32_t words[2];
+        std::memcpy(words, buf, 8);
+
+        const uint32_t seq = e.sequence.load(std::memory_order_relaxed);
+        e.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.words[0].store(words[0], std::memory_order_relaxed);
+        e.words[1].store(words[1], std::memory_order_relaxed);
+        e.timestamp[0].store(static_cast<uint32_t>(timestamp), std::memory_order_relaxed);
+        e.timestamp[1].store(static_cast<uint32_t>(timestamp >> 32), std::memory_order_relaxed);
+        e.stale.store(0, std::memory_order_relaxed);
+        e.sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    can_StoreEntry entries_[Count];
+};
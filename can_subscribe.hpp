@@ -0,0 +1,97 @@
+#pragma once
+
+// Signal change notifications.
+// Each incoming payload is XORed with the previous payload of the same message
+// and masked with the union of the subscribed signals' bits. Frames that did not
+// touch a subscribed bit cost one load, one XOR and one AND; otherwise only the
+// signals whose own bits changed are decoded and notified.
+// Fixed capacity, no heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+typedef void (*can_SignalCallback)(void* context, const can_Signal& signal, float value, uint64_t timestamp);
+
+template <size_t Messages, size_t Subscriptions>
+class can_SubscriptionEngine {
+  public:
+    can_SubscriptionEngine() {
+        for (size_t i = 0; i < Messages; ++i) {
+            messages_[i].previous = 0;
+            messages_[i].unionMask = 0;
+            messages_[i].first = NONE;
+            messages_[i].seen = false;
+        }
+    }
+
+    // Returns the subscription number, or -1 when the table is full.
+    // The signal is copied; the first frame of the message always notifies.
+    int subscribe(const size_t message, const can_Signal& signal, const can_SignalCallback callback, void* context) {
+        if (count_ >= Subscriptions || message >= Messages)
+            return -1;
+        Subscription& sub = subs_[count_];
+        sub.signal = signal;
+        sub.mask = can_signalMask(signal);
+        sub.callback = callback;
+        sub.context = context;
+        sub.next = messages_[message].first;
+        messages_[message].first = count_;
+        messages_[message].unionMask |= sub.mask;
+        return static_cast<int>(count_++);
+    }
+
+    // Returns the number of callbacks made; a message outside the table makes none
+    size_t onFrame(const size_t message, const uint8_t (&buf)[8], const uint64_t timestamp) {
+        if (message >= Messages)
+            return 0;
+        Message& msg = messages_[message];
+        uint64_t word;
+        std::memcpy(&word, buf, 8);
+        const uint64_t changed = (msg.seen ? (word ^ msg.previous) : -1ULL) & msg.unionMask;
+        msg.previous = word;
+        msg.seen = true;
+        if (!changed)
+            return 0;
+
+        size_t notified = 0;
+        for (size_t i = msg.first; i != NONE; i = subs_[i].next) {
+            const Subscription& sub = subs_[i];
+            if (changed & sub.mask) {
+                sub.callback(sub.context, sub.signal, can_getSignal(buf, sub.signal), timestamp);
+                ++notified;
+            }
+        }
+        return notified;
+    }
+
+    // Forget the previous payload so the next frame notifies every subscriber again
+    void reset(const size_t message) {
+        if (message < Messages)
+            messages_[message].seen = false;
+    }
+
+  private:
+    static const size_t NONE = static_cast<size_t>(-1);
+
+    struct Subscription {
+        can_Signal signal;
+        uint64_t mask;
+        can_SignalCallback callback;
+        void* context;
+        size_t next;
+    };
+
+    struct Message {
+        uint64_t previous;
+        uint64_t unionMask;
+        size_t first;
+        bool seen;
+    };
+
+    Message messages_[Messages];
+    Subscription subs_[Subscriptions];
+    size_t count_ = 0;
+};
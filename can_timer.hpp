@@ -0,0 +1,154 @@
+#pragma once
+
+// Hierarchical timing wheel with O(1) schedule and cancel.
+// Timers are intrusive and owned by the caller, so the wheel never allocates.
+// Time is measured in ticks of whatever resolution the caller picks; advance()
+// is driven by the caller's clock, which makes it easy to simulate in tests.
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct can_Timer;
+
+typedef void (*can_TimerCallback)(void* context, can_Timer& timer, uint64_t now);
+
+struct can_Timer {
+    can_TimerCallback callback;
+    void* context;
+    uint64_t expiry;
+    can_Timer* next;
+    can_Timer** pprev; // null while not scheduled
+};
+
+inline void can_initTimer(can_Timer& timer, const can_TimerCallback callback, void* context) {
+    timer.callback = callback;
+    timer.context = context;
+    timer.expiry = 0;
+    timer.next = nullptr;
+    timer.pprev = nullptr;
+}
+
+// Levels * SlotBits bits of delay are covered exactly; longer delays are parked in
+// the last level and re-sorted as the wheel turns.
+template <size_t Levels = 4, size_t SlotBits = 6>
+class can_TimerWheel {
+  public:
+    explicit can_TimerWheel(const uint64_t now = 0) : current_(now) {
+        for (size_t l = 0; l < Levels; ++l) {
+            for (size_t s = 0; s < SLOTS; ++s)
+                slots_[l][s] = nullptr;
+        }
+    }
+
+    uint64_t now() const { return current_; }
+    size_t size() const { return count_; }
+
+    static bool pending(const can_Timer& timer) { return timer.pprev != nullptr; }
+
+    // (Re)arm a timer; expiries in the past fire on the next advance()
+    void schedule(can_Timer& timer, const uint64_t expiry) {
+        if (pending(timer))
+            unlink(timer);
+        else
+            ++count_;
+        timer.expiry = expiry;
+        insert(timer);
+    }
+
+    void cancel(can_Timer& timer) {
+        if (!pending(timer))
+            return;
+        unlink(timer);
+        --count_;
+    }
+
+    // Fire every timer due at or before now; returns the number fired.
+    // Callbacks may schedule or cancel any timer, including their own.
+    size_t advance(const uint64_t now) {
+        size_t fired = 0;
+        while (current_ <= now) {
+            if (count_ == 0) {
+                current_ = now + 1;
+                break;
+            }
+            const uint64_t tick = current_;
+            if ((tick & MASK) == 0)
+                cascade(tick);
+
+            can_Timer* list = slots_[0][tick & MASK];
+            slots_[0][tick & MASK] = nullptr;
+            if (list)
+                list->pprev = &list;
+            ++current_;
+            while (list) {
+                can_Timer& timer = *list;
+                unlink(timer);
+                if (timer.expiry > tick) {
+                    // Parked beyond the wheel's range; sort it in again
+                    insert(timer);
+                    continue;
+                }
+                --count_;
+                timer.callback(timer.context, timer, tick);
+                ++fired;
+            }
+        }
+        return fired;
+    }
+
+  private:
+    static const size_t SLOTS = static_cast<size_t>(1) << SlotBits;
+    static const uint64_t MASK = SLOTS - 1;
+
+    void unlink(can_Timer& timer) {
+        *timer.pprev = timer.next;
+        if (timer.next)
+            timer.next->pprev = timer.pprev;
+        timer.next = nullptr;
+        timer.pprev = nullptr;
+    }
+
+    void push(can_Timer*& head, can_Timer& timer) {
+        timer.next = head;
+        if (head)
+            head->pprev = &timer.next;
+        head = &timer;
+        timer.pprev = &head;
+    }
+
+    void insert(can_Timer& timer) {
+        const uint64_t expiry = timer.expiry < current_ ? current_ : timer.expiry;
+        const uint64_t delta = expiry - current_;
+        for (size_t level = 0; level < Levels; ++level) {
+            if (level + 1 == Levels || delta < (static_cast<uint64_t>(1) << (SlotBits * (level + 1)))) {
+                uint64_t slotTime = expiry;
+                if (level + 1 == Levels && (delta >> (SlotBits * Levels)) != 0)
+                    slotTime = current_ + (MASK << (SlotBits * level)); // as far out as the wheel reaches
+                push(slots_[level][(slotTime >> (SlotBits * level)) & MASK], timer);
+                return;
+            }
+        }
+    }
+
+    // Move the timers of the upper-level slots that start at this tick down a level
+    void cascade(const uint64_t tick) {
+        for (size_t level = 1; level < Levels; ++level) {
+            const size_t index = (tick >> (SlotBits * level)) & MASK;
+            can_Timer* list = slots_[level][index];
+            slots_[level][index] = nullptr;
+            if (list)
+                list->pprev = &list;
+            while (list) {
+                can_Timer& timer = *list;
+                unlink(timer);
+                insert(timer);
+            }
+            if (index != 0)
+                break;
+        }
+    }
+
+    can_Timer* slots_[Levels][SLOTS];
+    uint64_t current_;
+    size_t count_ = 0;
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+// Operations on decoded signal columns: a time-ordered list of timestamps
+// (microseconds) with one value per timestamp.
+
+#include <cmath>
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "can_helpers.hpp"
+
+// Decoded history of one signal
+struct can_SignalColumn {
+    std::vector<uint64_t> timestamps;
+    std::vector<float> values;
+};
+
+enum can_Interpolation {
+    CAN_HOLD,   // zero-order hold: last sample at or before the target time
+    CAN_LINEAR, // linear between the surrounding samples, held after the last one
+};
+
+// As-of join of one sorted column onto sorted target times, in a single pass.
+// The index search runs in blocks; the gather and interpolation of each block is
+// a branch-free loop that GCC can vectorize. Targets before the first sample get `missing`.
+inline void can_asofJoin(const uint64_t* timestamps, const float* values, const size_t n, const uint64_t* targets, const size_t count, float* out, const can_Interpolation mode, const float missing) {
+    const size_t block = 256;
+    int64_t index[block];
+    size_t j = 0; // samples at or before the current target
+
+    for (size_t b = 0; b < count; b += block) {
+        const size_t m = count - b < block ? count - b : block;
+        const uint64_t* t = targets + b;
+        float* o = out + b;
+
+        for (size_t i = 0; i < m; ++i) {
+            while (j < n && timestamps[j] <= t[i])
+                ++j;
+            index[i] = static_cast<int64_t>(j) - 1;
+        }
+
+        if (n == 0) {
+            for (size_t i = 0; i < m; ++i)
+                o[i] = missing;
+        } else if (mode == CAN_HOLD) {
+            for (size_t i = 0; i < m; ++i) {
+                const int64_t k = index[i] < 0 ? 0 : index[i];
+                o[i] = index[i] < 0 ? missing : values[k];
+            }
+        } else {
+            const int64_t last = static_cast<int64_t>(n) - 1;
+            for (size_t i = 0; i < m; ++i) {
+                const int64_t lo = index[i] < 0 ? 0 : index[i];
+                const int64_t hi = lo < last ? lo + 1 : lo;
+                const uint64_t span = timestamps[hi] - timestamps[lo];
+                const float frac = span ? static_cast<float>(t[i] - timestamps[lo]) / static_cast<float>(span) : 0.0f;
+                const float v = values[lo] + (values[hi] - values[lo]) * frac;
+                o[i] = index[i] < 0 ? missing : v;
+            }
+        }
+    }
+}
+
+// Resample onto the grid start, start + period, ... (count points)
+inline void can_resample(const uint64_t* timestamps, const float* values, const size_t n, const uint64_t start, const uint64_t period, const size_t count, float* out, const can_Interpolation mode, const float missing) {
+    const size_t block = 256;
+    uint64_t grid[block];
+    size_t first = 0;
+    // Skip the samples before the grid so each block only scans forward
+    while (first + 1 < n && timestamps[first + 1] <= start)
+        ++first;
+    for (size_t b = 0; b < count; b += block) {
+        const size_t m = count - b < block ? count - b : block;
+        for (size_t i = 0; i < m; ++i)
+            grid[i] = start + (b + i) * period;
+        while (first + 1 < n && timestamps[first + 1] <= grid[0])
+            ++first;
+        can_asofJoin(timestamps + first, values + first, n - first, grid, m, out + b, mode, missing);
+    }
+}
+
+// Align several columns onto one common grid; out[c] receives count values for column c
+inline void can_alignColumns(const can_SignalColumn* columns, const size_t columnCount, const uint64_t start, const uint64_t period, const size_t count, std::vector<float>* out, const can_Interpolation mode, const float missing) {
+    for (size_t c = 0; c < columnCount; ++c) {
+        out[c].resize(count);
+        can_resample(columns[c].timestamps.data(), columns[c].values.data(), columns[c].timestamps.size(), start, period, count, out[c].data(), mode, missing);
+    }
+}
+
+// Per-second rate of change between consecutive samples; out[0] and samples with
+// no time step get 0. Branch-free, so GCC can vectorize it.
+inline void can_rateOfChange(const uint64_t* timestamps, const float* values, const size_t n, float* out) {
+    if (n == 0)
+        return;
+    out[0] = 0.0f;
+    for (size_t i = 1; i < n; ++i) {
+        const float dt = static_cast<float>(timestamps[i] - timestamps[i - 1]);
+        const float step = values[i] - values[i - 1];
+        out[i] = dt > 0.0f ? step * 1e6f / (dt > 0.0f ? dt : 1.0f) : 0.0f;
+    }
+}
+
+// Unwrap a counter signal (odometer, energy, pulse count) from its raw values, as
+// returned by can_getRawSignal. The counter wraps after 2^length raw steps, so every
+// step is taken modulo that, like can_TimestampUnwrapper does, and counted in a
+// 64-bit integer; scaling happens once per output, so no count is lost however wide
+// the counter or however often it wraps. unwrapped gets the continuous physical
+// value, starting from the first sample, in double as totals soon outgrow float
+// precision; rate gets the per-second rate like can_rateOfChange. Either output may
+// be null. Steps are corrected per block in a branch-free loop; only the running
+// total is serial.
+inline void can_unwrapCounter(const uint64_t* timestamps, const int64_t* raw, const size_t n, const can_Signal& sig, double* unwrapped, float* rate) {
+    if (n == 0)
+        return;
+    const size_t block = 256;
+    uint64_t steps[block];
+    const uint64_t mask = sig.length < 64 ? (1ULL << sig.length) - 1ULL : -1ULL;
+    const uint64_t first = static_cast<uint64_t>(raw[0]) & mask;
+    uint64_t total = 0;
+    if (unwrapped)
+        unwrapped[0] = (static_cast<double>(first) * sig.factor) + sig.offset;
+    if (rate)
+        rate[0] = 0.0f;
+
+    for (size_t b = 1; b < n; b += block) {
+        const size_t m = n - b < block ? n - b : block;
+        const int64_t* r = raw + b;
+        for (size_t i = 0; i < m; ++i)
+            steps[i] = static_cast<uint64_t>(r[i] - r[i - 1]) & mask;
+        if (rate) {
+            const uint64_t* t = timestamps + b;
+            for (size_t i = 0; i < m; ++i) {
+                const float dt = static_cast<float>(t[i] - t[i - 1]);
+                rate[b + i] = dt > 0.0f ? static_cast<float>(steps[i]) * sig.factor * 1e6f / (dt > 0.0f ? dt : 1.0f) : 0.0f;
+            }
+        }
+        if (unwrapped) {
+            for (size_t i = 0; i < m; ++i) {
+                total += steps[i];
+                unwrapped[b + i] = (static_cast<double>(first + total) * sig.factor) + sig.offset;
+            }
+        }
+    }
+}
+
+// Mergeable quantile sketch with relative accuracy (DDSketch style): values fall into
+// logarithmic buckets, so samples can be removed again when they leave a window.
+// Magnitudes outside [1e-9, 1e9] are clamped into the outermost buckets. The bucket
+// count grows with the accuracy: about 2k per sign at 0.01, 20k at 0.001.
+class can_QuantileSketch {
+  public:
+    explicit can_QuantileSketch(const float relativeAccuracy = 0.01f)
+        : gamma_((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy)), logGamma_(std::log(gamma_)),
+          offset_(-static_cast<int>(std::ceil(std::log(1e-9) / logGamma_))),
+          bins_(static_cast<size_t>(static_cast<int>(std::ceil(std::log(1e9) / logGamma_)) + offset_ + 1)),
+          positive_(bins_, 0), negative_(bins_, 0) {}
+
+    void add(const float value) { adjust(value, 1); }
+    void remove(const float value) { adjust(value, -1); }
+    size_t count() const { return count_; }
+
+    // q in [0, 1]; scans the buckets, so cost depends on the sketch size, not on the sample count
+    float quantile(const float q) const {
+        if (count_ == 0)
+            return 0.0f;
+        const size_t rank = static_cast<size_t>(q * (count_ - 1));
+        size_t seen = 0;
+        for (size_t i = bins_; i-- > 0;) {
+            seen += negative_[i];
+            if (seen > rank)
+                return -value(i);
+        }
+        seen += zero_;
+        if (seen > rank)
+            return 0.0f;
+        for (size_t i = 0; i < bins_; ++i) {
+            seen += positive_[i];
+            if (seen > rank)
+                return value(i);
+        }
+        return value(bins_ - 1);
+    }
+
+  private:
+    size_t bin(const float magnitude) const {
+        const int key = static_cast<int>(std::ceil(std::log(magnitude) / logGamma_)) + offset_;
+        return key < 0 ? 0 : (key >= static_cast<int>(bins_) ? bins_ - 1 : static_cast<size_t>(key));
+    }
+
+    float value(const size_t i) const {
+        return static_cast<float>(2.0 * std::pow(gamma_, static_cast<int>(i) - offset_) / (gamma_ + 1.0));
+    }
+
+    void adjust(const float value, const int delta) {
+        const float minMagnitude = 1e-9f;
+        if (value > minMagnitude)
+            positive_[bin(value)] += delta;
+        else if (value < -minMagnitude)
+            negative_[bin(-value)] += delta;
+        else
+            zero_ += delta;
+        count_ += delta;
+    }
+
+    double gamma_;
+    double logGamma_;
+    int offset_; // bucket index of key 0, i.e. magnitude 1
+    size_t bins_;
+    std::vector<uint32_t> positive_;
+    std::vector<uint32_t> negative_;
+    uint32_t zero_ = 0;
+    size_t count_ = 0;
+};
+
+static const size_t CAN_MAX_QUANTILES = 4;
+
+struct can_WindowStats {
+    uint64_t timestamp; // end of the window, inclusive
+    size_t count;       // samples inside the window; the other fields are 0 when empty
+    float mean;
+    float min;
+    float max;
+    float quantiles[CAN_MAX_QUANTILES];
+};
+
+// Rolling statistics over a time window, emitted every `interval` microseconds.
+// Emission times are multiples of the interval, and each covers (t - window, t].
+// Samples must arrive in time order. Mean, min and max are O(1) amortized per
+// sample (running sum and monotonic deques); quantiles come from a sketch.
+class can_WindowAggregator {
+  public:
+    can_WindowAggregator(const uint64_t window, const uint64_t interval, const float* quantiles = nullptr, const size_t quantileCount = 0, const float relativeAccuracy = 0.01f)
+        : window_(window), interval_(interval ? interval : 1), sketch_(relativeAccuracy) {
+        quantileCount_ = quantileCount < CAN_MAX_QUANTILES ? quantileCount : CAN_MAX_QUANTILES;
+        for (size_t i = 0; i < quantileCount_; ++i)
+            quantiles_[i] = quantiles[i];
+    }
+
+    // Appends the results of every emission time before the sample
+    void push(const uint64_t timestamp, const float value, std::vector<can_WindowStats>& out) {
+        if (!started_) {
+            nextEmit_ = (timestamp + interval_ - 1) / interval_ * interval_;
+            started_ = true;
+        }
+        while (nextEmit_ < timestamp)
+            emit(out);
+
+        Sample s = {timestamp, value};
+        samples_.push_back(s);
+        sum_ += value;
+        while (!mins_.empty() && mins_.back().value >= value)
+            mins_.pop_back();
+        mins_.push_back(s);
+        while (!maxs_.empty() && maxs_.back().value <= value)
+            maxs_.pop_back();
+        maxs_.push_back(s);
+        if (quantileCount_)
+            sketch_.add(value);
+    }
+
+    void push(const uint64_t* timestamps, const float* values, const size_t count, std::vector<can_WindowStats>& out) {
+        for (size_t i = 0; i < count; ++i)
+            push(timestamps[i], values[i], out);
+    }
+
+    // Emit every result up to and including the given time
+    void flush(const uint64_t until, std::vector<can_WindowStats>& out) {
+        while (started_ && nextEmit_ <= until)
+            emit(out);
+    }
+
+  private:
+    struct Sample {
+        uint64_t timestamp;
+        float value;
+    };
+
+    void emit(std::vector<can_WindowStats>& out) {
+        const uint64_t now = nextEmit_;
+        // Drop samples at or before now - window
+        while (!samples_.empty() && samples_.front().timestamp + window_ <= now) {
+            sum_ -= samples_.front().value;
+            if (quantileCount_)
+                sketch_.remove(samples_.front().value);
+            samples_.pop_front();
+        }
+        while (!mins_.empty() && mins_.front().timestamp + window_ <= now)
+            mins_.pop_front();
+        while (!maxs_.empty() && maxs_.front().timestamp + window_ <= now)
+            maxs_.pop_front();
+
+        can_WindowStats stats;
+        stats.timestamp = now;
+        stats.count = samples_.size();
+        stats.mean = samples_.empty() ? 0.0f : static_cast<float>(sum_ / samples_.size());
+        stats.min = mins_.empty() ? 0.0f : mins_.front().value;
+        stats.max = maxs_.empty() ? 0.0f : maxs_.front().value;
+        for (size_t i = 0; i < CAN_MAX_QUANTILES; ++i)
+            stats.quantiles[i] = i < quantileCount_ ? sketch_.quantile(quantiles_[i]) : 0.0f;
+        if (samples_.empty())
+            sum_ = 0.0; // shed accumulated rounding error
+        out.push_back(stats);
+        nextEmit_ += interval_;
+    }
+
+    uint64_t window_;
+    uint64_t interval_;
+    uint64_t nextEmit_ = 0;
+    bool started_ = false;
+    std::deque<Sample> samples_;
+    std::deque<Sample> mins_;
+    std::deque<Sample> maxs_;
+    double sum_ = 0.0;
+    can_QuantileSketch sketch_;
+    float quantiles_[CAN_MAX_QUANTILES];
+    size_t quantileCount_ = 0;
+};
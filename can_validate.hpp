@@ -0,0 +1,172 @@
+#pragma once
+
+// Alive counter and checksum validation at decode time.
+// A message is declared as its signals plus a can_Validator describing the
+// counter signal and a byte-wise XOR or sum checksum. decode() loads the
+// payload once: the checksum is folded out of that 64-bit word, the counter is
+// compared with the message's previous one, and only a frame passing both has
+// its signals extracted from the same word. Little-endian hosts; fixed
+// capacity, no heap.
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_helpers.hpp"
+
+enum can_ChecksumKind : uint8_t {
+    CAN_CHECKSUM_NONE,
+    CAN_CHECKSUM_XOR, // XOR of the covered bytes and the seed
+    CAN_CHECKSUM_SUM, // sum of the covered bytes and the seed, modulo 256
+};
+
+struct can_Validator {
+    can_Signal counter; // alive counter, wrapping at 2^length; length 0 if none
+    uint8_t maxDelta;   // largest accepted counter step, 1 if no frame may be lost
+    can_ChecksumKind checksum;
+    uint8_t checksumByte; // excluded from its own checksum
+    uint8_t length;       // payload bytes covered, and the shortest accepted frame
+    uint8_t seed;
+};
+
+struct can_CheckedMessage {
+    const can_Signal* signals;
+    size_t count;
+    can_Validator validator;
+};
+
+enum can_FrameCheck : uint8_t {
+    CAN_CHECK_OK,
+    CAN_CHECK_LENGTH,
+    CAN_CHECK_CHECKSUM,
+    CAN_CHECK_REPEATED, // counter did not move
+    CAN_CHECK_SEQUENCE, // counter jumped by more than maxDelta
+};
+
+inline uint8_t can_xorBytes(uint64_t word) {
+    word ^= word >> 32;
+    word ^= word >> 16;
+    word ^= word >> 8;
+    return static_cast<uint8_t>(word);
+}
+
+inline uint8_t can_sumBytes(const uint64_t word) {
+    // Pairwise into 16-bit lanes, then one multiply adds the lanes into the top one
+    const uint64_t pairs = (word & 0x00FF00FF00FF00FFULL) + ((word >> 8) & 0x00FF00FF00FF00FFULL);
+    return static_cast<uint8_t>((pairs * 0x0001000100010001ULL) >> 48);
+}
+
+// Counter state is kept per message index; signals are copied into a shared pool.
+template <size_t Messages, size_t Signals>
+class can_MessageValidator {
+  public:
+    // Returns the message index, or -1 when full or the validator is malformed
+    int add(const can_CheckedMessage& message) {
+        const can_Validator& v = message.validator;
+        if (messageCount_ >= Messages || signalCount_ + message.count > Signals || v.length > 8 || (v.checksum != CAN_CHECKSUM_NONE && v.checksumByte >= v.length))
+            return -1;
+        Message& m = messages_[messageCount_];
+        m.first = signalCount_;
+        m.count = message.count;
+        m.length = v.length;
+        m.checksum = v.checksum;
+        m.checksumShift = static_cast<uint8_t>(8 * v.checksumByte);
+        m.seed = v.seed;
+        m.covered = (v.length < 8 ? (1ULL << (8 * v.length)) - 1ULL : -1ULL) & ~(0xFFULL << m.checksumShift);
+        m.counter = compile(v.counter);
+        m.maxDelta = v.maxDelta;
+        m.last = 0;
+        m.synced = false;
+        for (size_t i = 0; i < message.count; ++i)
+            slots_[signalCount_++] = compile(message.signals[i]);
+        return static_cast<int>(messageCount_++);
+    }
+
+    size_t size() const { return messageCount_; }
+
+    // Validate and, only if valid, decode every signal of the message into values.
+    // The counter reference follows every frame with a good checksum, so a jump is
+    // reported once and the frames after it are accepted again.
+    can_FrameCheck decode(const size_t message, const uint8_t (&buf)[8], const uint8_t len, float* values) {
+        Message& m = messages_[message];
+        if (len < m.length)
+            return CAN_CHECK_LENGTH;
+        uint64_t word;
+        std::memcpy(&word, buf, 8);
+        const uint64_t swapped = __builtin_bswap64(word);
+
+        if (m.checksum != CAN_CHECKSUM_NONE) {
+            const uint64_t covered = word & m.covered;
+            const uint8_t expected = m.checksum == CAN_CHECKSUM_XOR ? can_xorBytes(covered) ^ m.seed : static_cast<uint8_t>(can_sumBytes(covered) + m.seed);
+            if (static_cast<uint8_t>(word >> m.checksumShift) != expected)
+                return CAN_CHECK_CHECKSUM;
+        }
+
+        if (m.counter.mask) {
+            const uint64_t counter = extract(word, swapped, m.counter);
+            const uint64_t delta = (counter - m.last) & m.counter.mask;
+            const bool synced = m.synced;
+            m.last = counter;
+            m.synced = true;
+            if (synced && delta == 0)
+                return CAN_CHECK_REPEATED;
+            if (synced && delta > m.maxDelta)
+                return CAN_CHECK_SEQUENCE;
+        }
+
+        for (size_t i = 0; i < m.count; ++i) {
+            const Slot& s = slots_[m.first + i];
+            const uint64_t raw = extract(word, swapped, s);
+            const int64_t value = s.isSigned ? can_signExtend(raw, s.length) : static_cast<int64_t>(raw);
+            values[i] = (value * s.factor) + s.offset;
+        }
+        return CAN_CHECK_OK;
+    }
+
+    // Forget the counter so the next frame is taken as the new reference
+    void reset(const size_t message) { messages_[message].synced = false; }
+
+  private:
+    struct Slot {
+        uint64_t mask; // 0 for an absent signal
+        float factor;
+        float offset;
+        uint8_t shift;
+        uint8_t length;
+        bool isIntel;
+        bool isSigned;
+    };
+
+    struct Message {
+        uint64_t covered; // checksum bytes, without the checksum itself
+        Slot counter;
+        uint64_t last;
+        size_t first;
+        size_t count;
+        uint8_t length;
+        can_ChecksumKind checksum;
+        uint8_t checksumShift;
+        uint8_t seed;
+        uint8_t maxDelta;
+        bool synced;
+    };
+
+    static Slot compile(const can_Signal& sig) {
+        Slot s;
+        s.mask = sig.length == 0 ? 0 : sig.length < 64 ? (1ULL << sig.length) - 1ULL : -1ULL;
+        s.factor = sig.factor;
+        s.offset = sig.offset;
+        s.shift = static_cast<uint8_t>(sig.isIntel ? sig.startBit : (56 - sig.startBit + (2 * (sig.startBit % 8))));
+        s.length = sig.length;
+        s.isIntel = sig.isIntel;
+        s.isSigned = sig.isSigned;
+        return s;
+    }
+
+    static uint64_t extract(const uint64_t word, const uint64_t swapped, const Slot& s) { return ((s.isIntel ? word : swapped) >> s.shift) & s.mask; }
+
+    Message messages_[Messages];
+    Slot slots_[Signals];
+    size_t messageCount_ = 0;
+    size_t signalCount_ = 0;
+};
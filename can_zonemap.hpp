@@ -0,0 +1,187 @@
+#pragma once
+
+// Per-chunk zone maps for columnar logs.
+// While a log is ingested, the builder records the raw min/max of every known
+// signal in every chunk into a sidecar file. Range queries consult the sidecar
+// and only decode chunks whose range can match.
+// Raw values are compared as int64_t, so unsigned 64-bit signals are not supported.
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include "can_columnar.hpp"
+
+static const uint32_t CAN_ZONEMAP_MAGIC = 0x504D5A43; // "CZMP"
+static const uint32_t CAN_ZONEMAP_VERSION = 1;
+
+struct can_ZoneRange {
+    int64_t min;
+    int64_t max;
+};
+
+// On-disk record, followed by signalCount can_ZoneRange entries
+struct can_ZoneMapEntry {
+    uint64_t chunkOffset; // position of the chunk in the columnar log
+    uint64_t minTimestamp;
+    uint64_t maxTimestamp;
+    uint32_t id;
+    uint32_t count;
+    uint8_t flags;
+    uint8_t bus;
+    uint16_t signalCount;
+    uint32_t reserved;
+};
+
+class can_ZoneMapBuilder : public can_ChunkListener {
+  public:
+    can_ZoneMapBuilder() {}
+    ~can_ZoneMapBuilder() { close(); }
+
+    // Signals must stay alive while the builder is in use. Standard and extended
+    // identifiers with the same value are different messages.
+    void addMessage(const uint32_t id, const can_Signal* signals, const size_t count, const bool extended = false) {
+        Message& msg = messages_[key(id, extended)];
+        msg.signals = signals;
+        msg.count = count;
+    }
+
+    bool open(const char* path) {
+        close();
+        file_ = std::fopen(path, "wb");
+        if (!file_)
+            return false;
+        const uint32_t header[2] = {CAN_ZONEMAP_MAGIC, CAN_ZONEMAP_VERSION};
+        ok_ = std::fwrite(header, sizeof(header), 1, file_) == 1;
+        return ok_;
+    }
+
+    bool close() {
+        if (!file_)
+            return true;
+        ok_ = (std::fclose(file_) == 0) && ok_;
+        file_ = nullptr;
+        return ok_;
+    }
+
+    void onChunk(const can_ChunkHeader& header, const uint64_t offset, const uint64_t* timestamps, const uint64_t* payloads) {
+        (void)timestamps;
+        if (!file_)
+            return;
+        std::map<uint64_t, Message>::const_iterator it = messages_.find(key(header.id, (header.flags & CAN_FRAME_EXTENDED) != 0));
+        const size_t signalCount = it == messages_.end() ? 0 : it->second.count;
+        const size_t lanes = (header.len + 7) / 8;
+
+        ranges_.resize(signalCount);
+        for (size_t s = 0; s < signalCount; ++s) {
+            ranges_[s].min = INT64_MAX;
+            ranges_[s].max = INT64_MIN;
+        }
+        if (lanes > 0) {
+            for (uint32_t i = 0; i < header.count; ++i) {
+                const uint8_t* data = reinterpret_cast<const uint8_t*>(&payloads[i * lanes]);
+                for (size_t s = 0; s < signalCount; ++s) {
+                    const int64_t raw = can_getRawSignal(data, lanes * 8, it->second.signals[s]);
+                    if (raw < ranges_[s].min)
+                        ranges_[s].min = raw;
+                    if (raw > ranges_[s].max)
+                        ranges_[s].max = raw;
+                }
+            }
+        }
+
+        can_ZoneMapEntry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.chunkOffset = offset;
+        entry.minTimestamp = header.minTimestamp;
+        entry.maxTimestamp = header.maxTimestamp;
+        entry.id = header.id;
+        entry.count = header.count;
+        entry.flags = header.flags;
+        entry.bus = header.bus;
+        entry.signalCount = lanes > 0 ? static_cast<uint16_t>(signalCount) : 0;
+        ok_ = std::fwrite(&entry, sizeof(entry), 1, file_) == 1 && ok_;
+        if (entry.signalCount)
+            ok_ = std::fwrite(ranges_.data(), sizeof(can_ZoneRange), entry.signalCount, file_) == entry.signalCount && ok_;
+    }
+
+  private:
+    can_ZoneMapBuilder(const can_ZoneMapBuilder&);
+    can_ZoneMapBuilder& operator=(const can_ZoneMapBuilder&);
+
+    struct Message {
+        const can_Signal* signals;
+        size_t count;
+    };
+
+    static uint64_t key(const uint32_t id, const bool extended) { return id | (static_cast<uint64_t>(extended) << 32); }
+
+    std::FILE* file_ = nullptr;
+    std::map<uint64_t, Message> messages_;
+    std::vector<can_ZoneRange> ranges_;
+    bool ok_ = false;
+};
+
+// In-memory copy of a sidecar file
+class can_ZoneMap {
+  public:
+    bool open(const char* path) {
+        entries_.clear();
+        ranges_.clear();
+        first_.clear();
+        can_MappedFile file;
+        if (!file.open(path) || file.size() < 8)
+            return false;
+
+        const uint8_t* p = file.data();
+        const uint8_t* end = p + file.size();
+        uint32_t header[2];
+        std::memcpy(header, p, sizeof(header));
+        if (header[0] != CAN_ZONEMAP_MAGIC || header[1] != CAN_ZONEMAP_VERSION)
+            return false;
+        p += sizeof(header);
+
+        while (p + sizeof(can_ZoneMapEntry) <= end) {
+            can_ZoneMapEntry entry;
+            std::memcpy(&entry, p, sizeof(entry));
+            p += sizeof(entry);
+            if (p + entry.signalCount * sizeof(can_ZoneRange) > end)
+                return false;
+            first_.push_back(ranges_.size());
+            ranges_.resize(ranges_.size() + entry.signalCount);
+            std::memcpy(ranges_.data() + first_.back(), p, entry.signalCount * sizeof(can_ZoneRange));
+            p += entry.signalCount * sizeof(can_ZoneRange);
+            entries_.push_back(entry);
+        }
+        return true;
+    }
+
+    size_t size() const { return entries_.size(); }
+    const can_ZoneMapEntry& entry(const size_t i) const { return entries_[i]; }
+
+    // Raw range of a signal in chunk i, as indexed in the message passed to the builder
+    const can_ZoneRange* range(const size_t i, const size_t signal) const {
+        return signal < entries_[i].signalCount ? &ranges_[first_[i] + signal] : nullptr;
+    }
+
+    // Offsets of the chunks of message id whose raw range for the signal overlaps
+    // [lo, hi]. Chunks without a recorded range cannot be ruled out and are included.
+    size_t findChunks(const uint32_t id, const size_t signal, const int64_t lo, const int64_t hi, std::vector<uint64_t>& offsets, const bool extended = false) const {
+        offsets.clear();
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (entries_[i].id != id || ((entries_[i].flags & CAN_FRAME_EXTENDED) != 0) != extended)
+                continue;
+            const can_ZoneRange* r = range(i, signal);
+            if (!r || (r->max >= lo && r->min <= hi))
+                offsets.push_back(entries_[i].chunkOffset);
+        }
+        return offsets.size();
+    }
+
+  private:
+    std::vector<can_ZoneMapEntry> entries_;
+    std::vector<can_ZoneRange> ranges_;
+    std::vector<size_t> first_;
+};